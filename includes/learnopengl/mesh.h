@@ -5,9 +5,12 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/packing.hpp>
 
-#include <learnopengl/shader.h>
+#include <learnopengl/shader_m.h>
 
+#include <cmath>
+#include <cstring>
 #include <string>
 #include <vector>
 using namespace std;
@@ -37,57 +40,241 @@ struct Texture {
     string path;
 };
 
+// optional parts of a packed vertex, chosen per mesh from the attributes it has and uses.
+// every vertex has a position, an octahedral normal (2 x 16 bit snorm) and half float texture coordinates.
+enum VertexFormatFlags {
+    VERTEX_TANGENTS = 1,            // octahedral tangent and bitangent, kept for meshes with a normal or height map
+    VERTEX_BONES = 2,               // int bone ids and float weights, kept if any vertex has a weight
+    VERTEX_QUANTIZED_POSITIONS = 4  // 16 bit snorm positions within the mesh bounds instead of floats, only on request
+};
+
+struct VertexFormat {
+    unsigned int flags;
+    // positions decode as positionOffset + positionScale * aPos in the vertex shader (0 and 1 for float positions)
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+};
+
+// locations of the uniforms Mesh sets on every draw, looked up once per program
+struct MeshUniforms {
+    MeshUniforms() : positionOffset(-1), positionScale(-1) {}
+    explicit MeshUniforms(const Shader &shader)
+        : positionOffset(shader.getUniformLocation("meshPositionOffset")), positionScale(shader.getUniformLocation("meshPositionScale")) {}
+    GLint positionOffset;
+    GLint positionScale;
+};
+
+// every mesh binds its texture_<type>N to the same unit, so the samplers are set once per program
+// (setMeshSamplerUnits) instead of every draw: the types' units follow each other, with
+// MESH_TEXTURES_PER_TYPE each. 4 types x 4 textures are the 16 units GL 3.3 guarantees.
+const unsigned int MESH_TEXTURES_PER_TYPE = 4;
+const char* const MESH_TEXTURE_TYPES[] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+const unsigned int MESH_TEXTURE_TYPE_COUNT = sizeof(MESH_TEXTURE_TYPES) / sizeof(MESH_TEXTURE_TYPES[0]);
+
+// points the program's texture_<type>N samplers at their units, call once after linking; leaves it in use
+inline void setMeshSamplerUnits(const Shader &shader)
+{
+    shader.use();
+    for (unsigned int type = 0; type < MESH_TEXTURE_TYPE_COUNT; type++)
+    {
+        for (unsigned int number = 1; number <= MESH_TEXTURES_PER_TYPE; number++)
+        {
+            GLint location = shader.getUniformLocation(MESH_TEXTURE_TYPES[type] + std::to_string(number));
+            if (location != -1)
+                shader.setInt(location, (int)(type * MESH_TEXTURES_PER_TYPE + number - 1));
+        }
+    }
+}
+
+// byte offsets of the attributes of a packed vertex
+struct VertexLayout {
+    unsigned int normal, texCoords, tangent, bitangent, boneIDs, weights, stride;
+};
+
+inline VertexLayout getVertexLayout(unsigned int flags)
+{
+    VertexLayout layout;
+    layout.normal = (flags & VERTEX_QUANTIZED_POSITIONS) ? 4 * sizeof(short) : 3 * sizeof(float);
+    layout.texCoords = layout.normal + 2 * sizeof(short);
+    layout.tangent = layout.texCoords + 2 * sizeof(short);
+    layout.bitangent = layout.tangent + ((flags & VERTEX_TANGENTS) ? 2 * sizeof(short) : 0);
+    layout.boneIDs = layout.bitangent + ((flags & VERTEX_TANGENTS) ? 2 * sizeof(short) : 0);
+    layout.weights = layout.boneIDs + ((flags & VERTEX_BONES) ? MAX_BONE_INFLUENCE * sizeof(int) : 0);
+    layout.stride = layout.weights + ((flags & VERTEX_BONES) ? MAX_BONE_INFLUENCE * sizeof(float) : 0);
+    return layout;
+}
+
+// unit vector folded onto the octahedron and unfolded into [-1, 1]^2, decoded by decodeOctahedral() in the shaders
+inline glm::vec2 encodeOctahedral(glm::vec3 n)
+{
+    float length = fabs(n.x) + fabs(n.y) + fabs(n.z);
+    if (length == 0.0f)
+        return glm::vec2(0.0f);
+    n /= length;
+    if (n.z >= 0.0f)
+        return glm::vec2(n.x, n.y);
+    return glm::vec2((1.0f - fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+// the smallest format holding what the vertices have and the textures use, plus the requested optional flags
+inline VertexFormat chooseVertexFormat(const vector<Vertex>& vertices, const vector<Texture>& textures, unsigned int requestedFlags)
+{
+    VertexFormat format;
+    format.flags = requestedFlags & VERTEX_QUANTIZED_POSITIONS;
+    format.positionOffset = glm::vec3(0.0f);
+    format.positionScale = glm::vec3(1.0f);
+
+    // tangent space is only read for normal and height maps
+    bool tangentsUsed = false;
+    for (unsigned int i = 0; i < textures.size(); i++)
+        tangentsUsed = tangentsUsed || textures[i].type == "texture_normal" || textures[i].type == "texture_height";
+
+    glm::vec3 low(0.0f), high(0.0f);
+    for (unsigned int i = 0; i < vertices.size(); i++)
+    {
+        const Vertex& vertex = vertices[i];
+        if (tangentsUsed && (vertex.Tangent != glm::vec3(0.0f) || vertex.Bitangent != glm::vec3(0.0f)))
+            format.flags |= VERTEX_TANGENTS;
+        for (unsigned int j = 0; j < MAX_BONE_INFLUENCE; j++)
+        {
+            if (vertex.m_Weights[j] != 0.0f)
+                format.flags |= VERTEX_BONES;
+        }
+        low = i == 0 ? vertex.Position : glm::min(low, vertex.Position);
+        high = i == 0 ? vertex.Position : glm::max(high, vertex.Position);
+    }
+
+    if (format.flags & VERTEX_QUANTIZED_POSITIONS)
+    {
+        format.positionOffset = (low + high) * 0.5f;
+        format.positionScale = (high - low) * 0.5f;
+        // flat along an axis, any scale decodes it
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (format.positionScale[axis] <= 0.0f)
+                format.positionScale[axis] = 1.0f;
+        }
+    }
+    return format;
+}
+
+// writes vertices in format, getVertexLayout(format.flags).stride bytes each
+inline void packVertices(const vector<Vertex>& vertices, const VertexFormat& format, vector<unsigned char>& packed)
+{
+    VertexLayout layout = getVertexLayout(format.flags);
+    packed.assign(vertices.size() * layout.stride, 0);
+    for (unsigned int i = 0; i < vertices.size(); i++)
+    {
+        const Vertex& vertex = vertices[i];
+        unsigned char* out = &packed[i * layout.stride];
+        if (format.flags & VERTEX_QUANTIZED_POSITIONS)
+        {
+            glm::vec3 p = (vertex.Position - format.positionOffset) / format.positionScale;
+            glm::uint xy = glm::packSnorm2x16(glm::vec2(p.x, p.y));
+            glm::uint z = glm::packSnorm2x16(glm::vec2(p.z, 0.0f));
+            memcpy(out, &xy, sizeof(xy));
+            memcpy(out + sizeof(xy), &z, sizeof(z));
+        }
+        else
+            memcpy(out, &vertex.Position, sizeof(vertex.Position));
+
+        glm::uint normal = glm::packSnorm2x16(encodeOctahedral(vertex.Normal));
+        memcpy(out + layout.normal, &normal, sizeof(normal));
+        glm::uint texCoords = glm::packHalf2x16(vertex.TexCoords);
+        memcpy(out + layout.texCoords, &texCoords, sizeof(texCoords));
+        if (format.flags & VERTEX_TANGENTS)
+        {
+            glm::uint tangent = glm::packSnorm2x16(encodeOctahedral(vertex.Tangent));
+            glm::uint bitangent = glm::packSnorm2x16(encodeOctahedral(vertex.Bitangent));
+            memcpy(out + layout.tangent, &tangent, sizeof(tangent));
+            memcpy(out + layout.bitangent, &bitangent, sizeof(bitangent));
+        }
+        if (format.flags & VERTEX_BONES)
+        {
+            memcpy(out + layout.boneIDs, vertex.m_BoneIDs, sizeof(vertex.m_BoneIDs));
+            memcpy(out + layout.weights, vertex.m_Weights, sizeof(vertex.m_Weights));
+        }
+    }
+}
+
 class Mesh {
 public:
     // mesh Data
-    vector<Vertex>       vertices;
+    VertexFormat         format;
+    unsigned int         vertexCount;
+    vector<unsigned char> vertexData; // packed in format
     vector<unsigned int> indices;
     vector<Texture>      textures;
     unsigned int VAO;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor, packs vertices into the smallest format they fit (see chooseVertexFormat)
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, unsigned int requestedFlags = 0)
     {
-        this->vertices = vertices;
+        this->format = chooseVertexFormat(vertices, textures, requestedFlags);
+        this->vertexCount = static_cast<unsigned int>(vertices.size());
+        packVertices(vertices, this->format, this->vertexData);
         this->indices = indices;
         this->textures = textures;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertexData.data(), this->indices.data(), this->indices.size());
+        setupTextureUnits();
+    }
+
+    // uploads vertices already packed in format straight from vertexData/indexData (a mapped cache file) without keeping a copy
+    Mesh(const VertexFormat& format, const unsigned char* vertexData, unsigned int vertexCount, const unsigned int* indexData, unsigned int indexCount, vector<Texture> textures)
+    {
+        this->format = format;
+        this->vertexCount = vertexCount;
+        this->textures = textures;
+
+        setupMesh(vertexData, indexData, indexCount);
+        setupTextureUnits();
+    }
+
+    // sources a per-instance mat4 (4 vec4 attributes from location firstLocation) from buffer, for DrawInstanced
+    void setInstanceBuffer(unsigned int buffer, unsigned int firstLocation)
+    {
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(firstLocation + i);
+            glVertexAttribPointer(firstLocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4) * i));
+            glVertexAttribDivisor(firstLocation + i, 1);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // render the mesh with shader, which is in use and had setMeshSamplerUnits() called on it
+    void Draw(Shader &shader, const MeshUniforms &uniforms)
+    {
+        DrawInstanced(shader, uniforms, 0);
     }
 
-    // render the mesh
-    void Draw(Shader &shader) 
+    // render instanceCount copies of the mesh in one draw, 0 draws it once without instancing
+    void DrawInstanced(Shader &shader, const MeshUniforms &uniforms, unsigned int instanceCount)
     {
+        // decodes quantized positions
+        shader.setVec3(uniforms.positionOffset, format.positionOffset);
+        shader.setVec3(uniforms.positionScale, format.positionScale);
+
         // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-             else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
+            if (textureUnits[i] == -1)
+                continue;
+            glActiveTexture(GL_TEXTURE0 + textureUnits[i]); // active proper texture unit before binding
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
         
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        if (instanceCount > 0)
+            glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, instanceCount);
+        else
+            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
@@ -97,10 +284,33 @@ public:
 private:
     // render data 
     unsigned int VBO, EBO;
+    unsigned int indexCount;
+    // texture unit of each texture (the one its texture_<type>N sampler reads), -1 if no sampler can read it
+    vector<int> textureUnits;
+
+    void setupTextureUnits()
+    {
+        // the N in texture_<type>N, per type
+        unsigned int numbers[MESH_TEXTURE_TYPE_COUNT] = {};
+        textureUnits.clear();
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            int unit = -1;
+            for (unsigned int type = 0; type < MESH_TEXTURE_TYPE_COUNT; type++)
+            {
+                if (textures[i].type == MESH_TEXTURE_TYPES[type] && numbers[type] < MESH_TEXTURES_PER_TYPE)
+                    unit = (int)(type * MESH_TEXTURES_PER_TYPE + numbers[type]++);
+            }
+            textureUnits.push_back(unit);
+        }
+    }
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const unsigned char* vertexData, const unsigned int* indexData, size_t indexCount)
     {
+        this->indexCount = static_cast<unsigned int>(indexCount);
+        VertexLayout layout = getVertexLayout(format.flags);
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -109,37 +319,42 @@ private:
         glBindVertexArray(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        glBufferData(GL_ARRAY_BUFFER, (size_t)vertexCount * layout.stride, vertexData, GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
 
-        // set the vertex attribute pointers
+        // set the vertex attribute pointers, the locations stay the same whatever the format
         // vertex Positions
-        glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(0);
+        if (format.flags & VERTEX_QUANTIZED_POSITIONS)
+            glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, layout.stride, (void*)0);
+        else
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)0);
+        // vertex normals (octahedral)
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, layout.stride, (void*)(size_t)layout.normal);
         // vertex texture coords
-        glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-		// ids
-		glEnableVertexAttribArray(5);
-		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-		// weights
-		glEnableVertexAttribArray(6);
-		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.texCoords);
+        if (format.flags & VERTEX_TANGENTS)
+        {
+            // vertex tangent (octahedral)
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, layout.stride, (void*)(size_t)layout.tangent);
+            // vertex bitangent (octahedral)
+            glEnableVertexAttribArray(4);
+            glVertexAttribPointer(4, 2, GL_SHORT, GL_TRUE, layout.stride, (void*)(size_t)layout.bitangent);
+        }
+        if (format.flags & VERTEX_BONES)
+        {
+            // ids
+            glEnableVertexAttribArray(5);
+            glVertexAttribIPointer(5, 4, GL_INT, layout.stride, (void*)(size_t)layout.boneIDs);
+            // weights
+            glEnableVertexAttribArray(6);
+            glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.weights);
+        }
         glBindVertexArray(0);
     }
 };
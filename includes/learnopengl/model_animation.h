@@ -44,8 +44,11 @@ public:
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
+        // looked up per call here, keep a MeshUniforms per program and draw the meshes directly where it matters
+        setMeshSamplerUnits(shader);
+        MeshUniforms uniforms(shader);
         for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+            meshes[i].Draw(shader, uniforms);
     }
     
 	auto& GetBoneInfoMap() { return m_BoneInfoMap; }
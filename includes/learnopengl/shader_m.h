@@ -4,18 +4,31 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+// bump whenever the program binary file layout changes
+const uint32_t SHADER_BINARY_CACHE_VERSION = 1;
+
 class Shader
 {
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
+    // preamble, if given, is inserted right after the #version line of both stages, then vertexDefines into the
+    // vertex shader alone; error line numbers still refer to the files
+    // the linked program is kept as a driver binary next to the vertex shader (<vertexPath>.<key>.progbin) and
+    // loaded from there while the sources, defines and driver stay the same, skipping compile and link
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string& preamble = std::string(), const std::string& vertexDefines = std::string())
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -45,9 +58,20 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
+        insertAfterVersion(vertexCode, preamble + vertexDefines);
+        insertAfterVersion(fragmentCode, preamble);
+        // 2. reuse the program binary of an earlier run
+        bool binaries = supportsProgramBinaries();
+        std::string binaryPath = getBinaryPath(vertexPath, fragmentPath, preamble + '\0' + vertexDefines);
+        uint64_t sourceHash = hashString(vertexCode + '\0' + fragmentCode, hashString(getDriverString()));
+        if (binaries && loadProgramBinary(binaryPath, sourceHash))
+        {
+            cacheUniformLocations();
+            return;
+        }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
+        // 3. compile shaders
         unsigned int vertex, fragment;
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -63,11 +87,17 @@ public:
         ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
+        if (binaries)
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        bool linked = checkCompileErrors(ID, "PROGRAM");
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+        if (binaries && linked)
+            saveProgramBinary(binaryPath, sourceHash);
+        // 4. look up every active uniform once, so setting one never has to ask the driver by name
+        cacheUniformLocations();
 
     }
     // activate the shader
@@ -76,69 +106,288 @@ public:
     { 
         glUseProgram(ID); 
     }
+    // location of an active uniform, -1 if the program has none by that name (like glGetUniformLocation)
+    // look these up once and use the location overloads below on hot paths
+    // ------------------------------------------------------------------------
+    GLint getUniformLocation(const std::string &name) const
+    {
+        std::unordered_map<std::string, GLint>::const_iterator it = uniformLocations.find(name);
+        return it == uniformLocations.end() ? -1 : it->second;
+    }
+    // points the named uniform block (if the program uses it) at a uniform buffer binding point
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const char* blockName, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, blockName);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(getUniformLocation(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(getUniformLocation(name), x, y); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(getUniformLocation(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) const
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(getUniformLocation(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+    }
+    // the same, by location
+    // ------------------------------------------------------------------------
+    void setBool(GLint location, bool value) const
+    {
+        glUniform1i(location, (int)value);
+    }
+    void setInt(GLint location, int value) const
+    {
+        glUniform1i(location, value);
+    }
+    void setFloat(GLint location, float value) const
+    {
+        glUniform1f(location, value);
+    }
+    void setVec2(GLint location, const glm::vec2 &value) const
+    {
+        glUniform2fv(location, 1, &value[0]);
+    }
+    void setVec3(GLint location, const glm::vec3 &value) const
+    {
+        glUniform3fv(location, 1, &value[0]);
+    }
+    void setVec4(GLint location, const glm::vec4 &value) const
+    {
+        glUniform4fv(location, 1, &value[0]);
+    }
+    void setMat3(GLint location, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(GLint location, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
-    // utility function for checking shader compilation/linking errors.
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    // a #line directive after the inserted text keeps the compiler's line numbers those of the file
+    // ------------------------------------------------------------------------
+    static void insertAfterVersion(std::string& code, const std::string& text)
+    {
+        if (text.empty())
+            return;
+        size_t versionEnd = code.find('\n', code.find("#version"));
+        size_t position = versionEnd == std::string::npos ? code.size() : versionEnd + 1;
+        size_t nextLine = std::count(code.begin(), code.begin() + position, '\n') + 1;
+        std::string inserted = text;
+        if (inserted[inserted.size() - 1] != '\n')
+            inserted += '\n';
+        code.insert(position, inserted + "#line " + std::to_string(nextLine) + "\n");
+    }
+
+    // fills uniformLocations with every active uniform of the linked program; arrays are reported as
+    // "name[0]", so each element and the bare name are added too
+    // ------------------------------------------------------------------------
+    void cacheUniformLocations()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::string buffer(maxLength > 0 ? maxLength : 1, '\0');
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, &buffer[0]);
+            std::string name(buffer.c_str(), length);
+            GLint location = glGetUniformLocation(ID, name.c_str());
+            // members of uniform blocks have no location
+            if (location < 0)
+                continue;
+            uniformLocations[name] = location;
+
+            size_t bracket = name.rfind("[0]");
+            if (bracket != std::string::npos && bracket + 3 == name.size())
+            {
+                std::string base = name.substr(0, bracket);
+                uniformLocations[base] = location;
+                for (GLint element = 1; element < size; element++)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    uniformLocations[elementName] = glGetUniformLocation(ID, elementName.c_str());
+                }
+            }
+        }
+    }
+
+    // program binaries are core in 4.1; on older contexts the entry points stay null unless the app loaded
+    // them from GL_ARB_get_program_binary
+    // ------------------------------------------------------------------------
+    static bool supportsProgramBinaries()
+    {
+        if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+            return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    // a binary is only valid for the driver that produced it
+    // ------------------------------------------------------------------------
+    static std::string getDriverString()
+    {
+        const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        std::string driver;
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            const GLubyte* value = glGetString(names[i]);
+            driver += value ? (const char*)value : "";
+            driver += '\n';
+        }
+        return driver;
+    }
+
+    // 64 bit FNV-1a
+    // ------------------------------------------------------------------------
+    static uint64_t hashString(const std::string& text, uint64_t hash = 14695981039346656037ULL)
+    {
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            hash ^= (unsigned char)text[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // one file per shader pair and inserted text, so programs sharing a vertex shader don't evict each other
+    // ------------------------------------------------------------------------
+    static std::string getBinaryPath(const char* vertexPath, const char* fragmentPath, const std::string& inserted)
+    {
+        char key[17];
+        snprintf(key, sizeof(key), "%016llx", (unsigned long long)hashString(std::string(vertexPath) + '\0' + fragmentPath + '\0' + inserted));
+        return std::string(vertexPath) + "." + key + ".progbin";
+    }
+
+    struct ProgramBinaryHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    // false if there is no binary for these sources and this driver, or the driver rejects it
+    // ------------------------------------------------------------------------
+    bool loadProgramBinary(const std::string& path, uint64_t sourceHash)
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        ProgramBinaryHeader header;
+        if (!file.read((char*)&header, sizeof(header)) || std::string(header.magic, 4) != "WPGB" || header.version != SHADER_BINARY_CACHE_VERSION
+            || header.sourceHash != sourceHash || header.length == 0)
+            return false;
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), binary.size()))
+            return false;
+
+        ID = glCreateProgram();
+        glProgramBinary(ID, header.format, binary.data(), (GLsizei)binary.size());
+        GLint success = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            // e.g. a driver update that kept the version string; compile instead and replace the file
+            glDeleteProgram(ID);
+            ID = 0;
+            return false;
+        }
+        return true;
+    }
+
+    // ------------------------------------------------------------------------
+    void saveProgramBinary(const std::string& path, uint64_t sourceHash)
+    {
+        GLint length = 0;
+        glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(ID, length, &length, &format, binary.data());
+
+        ProgramBinaryHeader header = { { 'W', 'P', 'G', 'B' }, SHADER_BINARY_CACHE_VERSION, sourceHash, format, (uint32_t)length };
+        // written aside and renamed over, so a starting instance never reads half a file; the name is per
+        // run, as another instance may be linking the same program
+        std::string tempPath = path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+        {
+            std::ofstream file(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+            file.write((const char*)&header, sizeof(header));
+            file.write(binary.data(), length);
+            if (!file)
+            {
+                std::cout << "Failed to write program binary: " << path << std::endl;
+                file.close();
+                std::remove(tempPath.c_str());
+                return;
+            }
+        }
+        std::remove(path.c_str());
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+            std::remove(tempPath.c_str());
+    }
+
+    // utility function for checking shader compilation/linking errors, false on failure
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -160,6 +409,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success != 0;
     }
 };
 #endif
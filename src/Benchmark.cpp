@@ -0,0 +1,146 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+Benchmark::Benchmark(const BenchmarkOptions& options) : options(options), framebuffer(0), colorBuffer(0), depthBuffer(0)
+{
+}
+
+bool Benchmark::initFramebuffer() {
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!complete) {
+        std::cout << "Benchmark framebuffer is not complete" << std::endl;
+        destroyFramebuffer();
+    }
+    return complete;
+}
+
+void Benchmark::destroyFramebuffer() {
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    framebuffer = colorBuffer = depthBuffer = 0;
+}
+
+void Benchmark::applyScript(Game& game, float t) {
+    Simulation& simulation = game.getSimulation();
+    float angle = 2.0f * (float)PI * t / BENCHMARK_STEER_LAP_TIME;
+    simulation.steerPlayer(glm::vec3(cos(angle), 0.0f, sin(angle)));
+    simulation.rotateCameras(BENCHMARK_CAMERA_ORBIT_SPEED, 0.0f);
+}
+
+bool Benchmark::run(Game& game) {
+    if (!initFramebuffer()) return false;
+
+    game.reset(options.seed, options.otherBoatsCount);
+    // every frame should draw the real textures
+    game.finishLoading();
+    Simulation& simulation = game.getSimulation();
+    if (!simulation.isBoatCameraActive()) simulation.switchCamera();
+
+    // one simulation step per frame, so the simulated run doesn't depend on how fast frames are
+    float dt = game.getSimulationStep();
+    bool wasProfiling = Profiler::isEnabled();
+    Profiler::setEnabled(false);
+
+    frameTimes.clear();
+    frameTimes.reserve(options.frames);
+    unsigned int totalFrames = BENCHMARK_WARMUP_FRAMES + options.frames;
+    for (unsigned int frame = 0; frame < totalFrames; frame++) {
+        if (frame == BENCHMARK_WARMUP_FRAMES) Profiler::setEnabled(true);
+        applyScript(game, (float)frame * dt);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Profiler::beginFrame();
+        game.update(dt);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        game.render(dt);
+        // count the GPU work of the frame too
+        glFinish();
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        if (frame >= BENCHMARK_WARMUP_FRAMES) frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        glfwPollEvents();
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    bool written = writeResults(game);
+    Profiler::setEnabled(wasProfiling);
+    destroyFramebuffer();
+    return written;
+}
+
+// nearest rank
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)ceil(p * (double)sorted.size());
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+bool Benchmark::writeResults(Game& game) {
+    std::vector<double> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0.0;
+    for (unsigned int i = 0; i < sorted.size(); i++) {
+        mean += sorted[i];
+    }
+    if (!sorted.empty()) mean /= (double)sorted.size();
+
+    std::vector<ProfileZoneStats> zones;
+    Profiler::getSummary(zones, options.frames);
+
+    Simulation& simulation = game.getSimulation();
+    glm::vec3 player = simulation.getPlayer().position;
+    const GLubyte* renderer = glGetString(GL_RENDERER);
+
+    std::ofstream out(options.outputPath.c_str());
+    if (!out) {
+        std::cout << "Failed to write benchmark results: " << options.outputPath << std::endl;
+        return false;
+    }
+
+    out << "{\n";
+    out << "  \"seed\": " << options.seed << ",\n";
+    out << "  \"frames\": " << options.frames << ",\n";
+    out << "  \"otherBoats\": " << options.otherBoatsCount << ",\n";
+    out << "  \"threads\": " << simulation.getJobThreads() + 1 << ",\n";
+    out << "  \"simulationStep\": " << game.getSimulationStep() << ",\n";
+    out << "  \"resolution\": [" << SCR_WIDTH << ", " << SCR_HEIGHT << "],\n";
+    out << "  \"renderer\": \"" << (renderer ? (const char*)renderer : "") << "\",\n";
+    out << "  \"frameTimeMs\": {\"mean\": " << mean << ", \"p50\": " << percentile(sorted, 0.50) << ", \"p95\": " << percentile(sorted, 0.95)
+        << ", \"p99\": " << percentile(sorted, 0.99) << ", \"max\": " << (sorted.empty() ? 0.0 : sorted.back()) << "},\n";
+    out << "  \"zonesMs\": [";
+    for (unsigned int i = 0; i < zones.size(); i++) {
+        const ProfileZoneStats& zone = zones[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << zone.name << "\", \"gpu\": " << (zone.gpu ? "true" : "false")
+            << ", \"count\": " << zone.count << ", \"mean\": " << zone.mean << ", \"p50\": " << zone.p50 << ", \"p95\": " << zone.p95
+            << ", \"p99\": " << zone.p99 << ", \"max\": " << zone.max << "}";
+    }
+    out << "\n  ],\n";
+    // same seed and script give the same end position, a changed one means the simulation changed
+    out << "  \"finalPlayerPosition\": [" << player.x << ", " << player.y << ", " << player.z << "]\n";
+    out << "}\n";
+
+    std::cout << "benchmark: " << options.frames << " frames, p50 " << percentile(sorted, 0.50) << " ms, p95 " << percentile(sorted, 0.95)
+        << " ms, p99 " << percentile(sorted, 0.99) << " ms -> " << options.outputPath << std::endl;
+    return (bool)out;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Game.h"
+
+#include <string>
+#include <vector>
+
+// Benchmark settings
+const unsigned int BENCHMARK_DEFAULT_SEED = 1;
+const unsigned int BENCHMARK_DEFAULT_FRAMES = 1000;
+// frames run before measuring, so shader compilation and first uploads don't land in the results
+const unsigned int BENCHMARK_WARMUP_FRAMES = 60;
+// the scripted player steers along a circle of this many seconds per lap while the camera orbits it
+const float BENCHMARK_STEER_LAP_TIME = 40.0f;
+const float BENCHMARK_CAMERA_ORBIT_SPEED = 4.0f;
+
+struct BenchmarkOptions {
+	BenchmarkOptions(): seed(BENCHMARK_DEFAULT_SEED), frames(BENCHMARK_DEFAULT_FRAMES), otherBoatsCount(MAX_OTHER_BOATS_COUNT) {}
+	unsigned int seed;
+	unsigned int frames;
+	unsigned int otherBoatsCount;
+	// JSON results go here
+	std::string outputPath;
+};
+
+// Reproducible performance run: restarts the game from a fixed seed, drives the player and camera
+// along a script instead of the input devices, advances exactly one simulation step per frame and
+// renders into an offscreen framebuffer. Writes the frame time percentiles (update + render + glFinish)
+// and the profiler zone breakdown as JSON.
+class Benchmark {
+	public:
+		explicit Benchmark(const BenchmarkOptions& options);
+
+		// needs the game's GL context current; false if the offscreen target or the output failed
+		bool run(Game& game);
+
+	private:
+		BenchmarkOptions options;
+		std::vector<double> frameTimes;
+
+		GLuint framebuffer, colorBuffer, depthBuffer;
+		bool initFramebuffer();
+		void destroyFramebuffer();
+
+		// scripted input t seconds of simulation in
+		void applyScript(Game& game, float t);
+		bool writeResults(Game& game);
+};
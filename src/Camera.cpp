@@ -140,3 +140,13 @@ glm::vec3 Camera::getPosition() {
     if (UseLerp) return currentLerpPosition;
     return Position;
 }
+
+glm::vec3 Camera::getForward() {
+    if (UseLerp) return currentLerpForward;
+    return Forward;
+}
+
+glm::vec3 Camera::getUp() {
+    if (UseLerp) return currentLerpUp;
+    return Up;
+}
@@ -70,6 +70,9 @@ public:
     void UpdateLerp(float dt);
 
     glm::vec3 getPosition();
+    // the vectors GetViewMatrix() looks along
+    glm::vec3 getForward();
+    glm::vec3 getUp();
 
 private:
     // calculates the front vector from the Camera's (updated) Euler Angles
@@ -0,0 +1,94 @@
+#include "Fleet.h"
+
+#include <algorithm>
+#include <cmath>
+
+void Fleet::clear() {
+    positionX.clear(); positionY.clear(); positionZ.clear();
+    forwardX.clear(); forwardY.clear(); forwardZ.clear();
+    rightX.clear(); rightY.clear(); rightZ.clear();
+    upX.clear(); upY.clear(); upZ.clear();
+    bearingX.clear(); bearingY.clear(); bearingZ.clear();
+    destDirX.clear(); destDirZ.clear();
+    speed.clear();
+    t_flip.clear();
+    isFlipped.clear();
+    followPlayer.clear();
+}
+
+void Fleet::add(const Boat& boat) {
+    positionX.push_back(boat.position.x); positionY.push_back(boat.position.y); positionZ.push_back(boat.position.z);
+    forwardX.push_back(boat.forward.x); forwardY.push_back(boat.forward.y); forwardZ.push_back(boat.forward.z);
+    rightX.push_back(boat.right.x); rightY.push_back(boat.right.y); rightZ.push_back(boat.right.z);
+    upX.push_back(boat.up.x); upY.push_back(boat.up.y); upZ.push_back(boat.up.z);
+    bearingX.push_back(boat.currentBearing.x); bearingY.push_back(boat.currentBearing.y); bearingZ.push_back(boat.currentBearing.z);
+    destDirX.push_back(boat.destDir.x); destDirZ.push_back(boat.destDir.z);
+    speed.push_back(boat.speed);
+    t_flip.push_back(boat.t_flip);
+    isFlipped.push_back(boat.isFlipped ? 1 : 0);
+    followPlayer.push_back(boat.followPlayer ? 1 : 0);
+}
+
+Boat Fleet::get(unsigned int i) const {
+    Boat boat;
+    boat.position = getPosition(i);
+    boat.forward = getForward(i);
+    boat.right = getRight(i);
+    boat.up = getUp(i);
+    boat.currentBearing = getBearing(i);
+    boat.speed = speed[i];
+    boat.isFlipped = isFlipped[i] != 0;
+    boat.t_flip = t_flip[i];
+    boat.followPlayer = followPlayer[i] != 0;
+    boat.destDir = getDestDir(i);
+    return boat;
+}
+
+void Fleet::turnBoat(unsigned int i, float directionX, float directionZ, float maxTurn) {
+    float directionScale = 1.0f / std::sqrt(directionX * directionX + directionZ * directionZ);
+    float dx = directionX * directionScale;
+    float dz = directionZ * directionScale;
+
+    float forwardScale = 1.0f / std::sqrt(forwardX[i] * forwardX[i] + forwardY[i] * forwardY[i] + forwardZ[i] * forwardZ[i]);
+    float fx = forwardX[i] * forwardScale;
+    float fy = forwardY[i] * forwardScale;
+    float fz = forwardZ[i] * forwardScale;
+
+    if (dx * fx + dz * fz < 0.0f) {
+        // behind: head for whichever side of cross(forward, up) is nearer
+        float sideScale = 1.0f / std::sqrt(fx * fx + fz * fz);
+        float sx = -fz * sideScale;
+        float sz = fx * sideScale;
+        if (sx * dx + sz * dz <= 0.0f) {
+            sx = -sx;
+            sz = -sz;
+        }
+        dx = sx;
+        dz = sz;
+    }
+
+    float turnX = dx - fx;
+    float turnY = -fy;
+    float turnZ = dz - fz;
+    float difference = std::sqrt(turnX * turnX + turnY * turnY + turnZ * turnZ);
+    float turn = std::min(difference, maxTurn);
+    if (difference < 0.0001f) {
+        turnX = dx * turn;
+        turnY = 0.0f;
+        turnZ = dz * turn;
+    }
+    else {
+        turn /= difference;
+        turnX *= turn;
+        turnY *= turn;
+        turnZ *= turn;
+    }
+    fx += turnX;
+    fy += turnY;
+    fz += turnZ;
+
+    float bearingScale = 1.0f / std::sqrt(fx * fx + fy * fy + fz * fz);
+    bearingX[i] = fx * bearingScale;
+    bearingY[i] = fy * bearingScale;
+    bearingZ[i] = fz * bearingScale;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+// std::vector allocator handing out storage aligned to Alignment bytes (32 = one AVX register)
+template <typename T, std::size_t Alignment = 32>
+struct AlignedAllocator {
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind {
+		typedef AlignedAllocator<U, Alignment> other;
+	};
+
+	AlignedAllocator() {}
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(std::size_t n) {
+		void* p = nullptr;
+#if defined(_MSC_VER)
+		p = _aligned_malloc(n * sizeof(T), Alignment);
+#else
+		if (posix_memalign(&p, Alignment, n * sizeof(T)) != 0) p = nullptr;
+#endif
+		if (p == nullptr) throw std::bad_alloc();
+		return static_cast<T*>(p);
+	}
+
+	void deallocate(T* p, std::size_t) {
+#if defined(_MSC_VER)
+		_aligned_free(p);
+#else
+		free(p);
+#endif
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+typedef std::vector<float, AlignedAllocator<float> > FleetFloats;
+typedef std::vector<unsigned char, AlignedAllocator<unsigned char> > FleetFlags;
+
+struct Boat {
+	Boat():
+		position(glm::vec3(0.0f)), forward(glm::vec3(0.0f, 0.0f, 1.0f)), right(glm::vec3(1.0f, 0.0f, 0.0f)), up(glm::vec3(0.0f, 1.0f, 0.0f)),
+		currentBearing(glm::vec3(0.0f, 0.0f, 1.0f)), speed(0.0f), isFlipped(false), t_flip(0.0f), followPlayer(false), destDir(glm::vec3(0.0f, 0.0f, 1.0f)) {}
+	glm::vec3 position;
+	glm::vec3 forward;
+	glm::vec3 right;
+	glm::vec3 up;
+	glm::vec3 currentBearing;
+	float speed;
+	bool isFlipped;
+	float t_flip;
+	bool followPlayer;
+	glm::vec3 destDir;
+};
+
+// The AI boats as structure of arrays: one contiguous, 32 byte aligned array per component, so each
+// simulation pass streams through only the fields it touches. Destinations always lie in the x/z plane,
+// so they have no y array.
+class Fleet {
+	public:
+		unsigned int size() const { return (unsigned int)positionX.size(); }
+		void clear();
+		void add(const Boat& boat);
+		// the boat as a whole, for dumps and debugging
+		Boat get(unsigned int i) const;
+
+		glm::vec3 getPosition(unsigned int i) const { return glm::vec3(positionX[i], positionY[i], positionZ[i]); }
+		glm::vec3 getForward(unsigned int i) const { return glm::vec3(forwardX[i], forwardY[i], forwardZ[i]); }
+		glm::vec3 getRight(unsigned int i) const { return glm::vec3(rightX[i], rightY[i], rightZ[i]); }
+		glm::vec3 getUp(unsigned int i) const { return glm::vec3(upX[i], upY[i], upZ[i]); }
+		glm::vec3 getBearing(unsigned int i) const { return glm::vec3(bearingX[i], bearingY[i], bearingZ[i]); }
+		glm::vec3 getDestDir(unsigned int i) const { return glm::vec3(destDirX[i], 0.0f, destDirZ[i]); }
+
+		void setPosition(unsigned int i, glm::vec3 v) { positionX[i] = v.x; positionY[i] = v.y; positionZ[i] = v.z; }
+		void setForward(unsigned int i, glm::vec3 v) { forwardX[i] = v.x; forwardY[i] = v.y; forwardZ[i] = v.z; }
+		void setRight(unsigned int i, glm::vec3 v) { rightX[i] = v.x; rightY[i] = v.y; rightZ[i] = v.z; }
+		void setUp(unsigned int i, glm::vec3 v) { upX[i] = v.x; upY[i] = v.y; upZ[i] = v.z; }
+		void setBearing(unsigned int i, glm::vec3 v) { bearingX[i] = v.x; bearingY[i] = v.y; bearingZ[i] = v.z; }
+		void setDestDir(unsigned int i, glm::vec3 v) { destDirX[i] = v.x; destDirZ[i] = v.z; }
+
+		// points boat i's bearing from its forward towards the flat direction, by at most maxTurn,
+		// going round the nearer side when the direction is behind
+		void turnBoat(unsigned int i, float directionX, float directionZ, float maxTurn);
+
+		FleetFloats positionX, positionY, positionZ;
+		FleetFloats forwardX, forwardY, forwardZ;
+		FleetFloats rightX, rightY, rightZ;
+		FleetFloats upX, upY, upZ;
+		FleetFloats bearingX, bearingY, bearingZ;
+		FleetFloats destDirX, destDirZ;
+		FleetFloats speed;
+		FleetFloats t_flip;
+		FleetFlags isFlipped;
+		FleetFlags followPlayer;
+};
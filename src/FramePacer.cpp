@@ -0,0 +1,137 @@
+#include "FramePacer.h"
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "winmm.lib")
+#endif
+#endif
+
+FramePacer::FramePacer() : mode(LIMITED), period(0), started(false), statsNext(0), statsCount(0)
+{
+    intervals.resize(FRAME_PACER_STATS_WINDOW);
+    sleeps.resize(FRAME_PACER_STATS_WINDOW);
+    spins.resize(FRAME_PACER_STATS_WINDOW);
+#ifdef _WIN32
+    // the default scheduler tick is ~15.6 ms, far coarser than FRAME_PACER_SPIN_MARGIN
+    timeBeginPeriod(1);
+#endif
+}
+
+FramePacer::~FramePacer() {
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::configure(Mode mode, double targetFps) {
+    this->mode = mode;
+    period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(targetFps > 0.0 ? 1.0 / targetFps : 0.0));
+    started = false;
+    statsNext = 0;
+    statsCount = 0;
+}
+
+FramePacer::Mode FramePacer::getMode() const {
+    return mode;
+}
+
+int FramePacer::getSwapInterval() const {
+    switch (mode) {
+    case VSYNC: return 1;
+    case ADAPTIVE: return -1;
+    default: return 0;
+    }
+}
+
+double FramePacer::waitForNextFrame() {
+    Clock::time_point now = Clock::now();
+    if (!started) {
+        started = true;
+        lastFrame = now;
+        deadline = now + period;
+        return 0.0;
+    }
+
+    double sleep = 0.0;
+    double spin = 0.0;
+    if (mode == LIMITED && period > Clock::duration::zero()) {
+        Clock::time_point sleepUntil = deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(FRAME_PACER_SPIN_MARGIN));
+        if (now < sleepUntil) std::this_thread::sleep_until(sleepUntil);
+        Clock::time_point woke = Clock::now();
+        while (Clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        Clock::time_point done = Clock::now();
+        sleep = std::chrono::duration<double>(woke - now).count();
+        spin = std::chrono::duration<double>(done - woke).count();
+
+        // a frame that ran late shortens the next wait, but more than a whole period late starts over
+        // from now instead of rushing several frames out to catch up
+        deadline += period;
+        if (deadline < done) deadline = done + period;
+    }
+
+    now = Clock::now();
+    double interval = std::chrono::duration<double>(now - lastFrame).count();
+    lastFrame = now;
+    record(interval, sleep, spin);
+    return interval;
+}
+
+void FramePacer::record(double interval, double sleep, double spin) {
+    intervals[statsNext] = interval;
+    sleeps[statsNext] = sleep;
+    spins[statsNext] = spin;
+    statsNext = (statsNext + 1) % FRAME_PACER_STATS_WINDOW;
+    if (statsCount < FRAME_PACER_STATS_WINDOW) statsCount++;
+}
+
+FramePacerStats FramePacer::getStats() const {
+    FramePacerStats stats;
+    stats.frames = statsCount;
+    if (statsCount == 0) return stats;
+
+    for (unsigned int i = 0; i < statsCount; i++) {
+        stats.meanInterval += intervals[i];
+        stats.sleepTime += sleeps[i];
+        stats.spinTime += spins[i];
+    }
+    stats.meanInterval /= statsCount;
+    stats.sleepTime /= statsCount;
+    stats.spinTime /= statsCount;
+
+    double target = mode == LIMITED && period > Clock::duration::zero() ? std::chrono::duration<double>(period).count() : stats.meanInterval;
+    for (unsigned int i = 0; i < statsCount; i++) {
+        double jitter = fabs(intervals[i] - target);
+        stats.meanJitter += jitter;
+        if (jitter > stats.maxJitter) stats.maxJitter = jitter;
+    }
+    stats.meanJitter /= statsCount;
+    return stats;
+}
+
+const char* FramePacer::getModeName(Mode mode) {
+    switch (mode) {
+    case VSYNC: return "vsync";
+    case ADAPTIVE: return "adaptive";
+    case UNCAPPED: return "uncapped";
+    default: return "limited";
+    }
+}
+
+bool FramePacer::parseMode(const char* name, Mode& mode) {
+    const Mode modes[] = { LIMITED, VSYNC, ADAPTIVE, UNCAPPED };
+    for (unsigned int i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcmp(name, getModeName(modes[i])) == 0) {
+            mode = modes[i];
+            return true;
+        }
+    }
+    return false;
+}
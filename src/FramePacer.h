@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+// Pacing settings
+// sleeps end this long before the deadline, the rest is spun off; covers the OS sleep granularity
+const double FRAME_PACER_SPIN_MARGIN = 0.001;
+// frames the pacing statistics are taken over
+const unsigned int FRAME_PACER_STATS_WINDOW = 240;
+
+struct FramePacerStats {
+	FramePacerStats(): frames(0), meanInterval(0.0), meanJitter(0.0), maxJitter(0.0), sleepTime(0.0), spinTime(0.0) {}
+	unsigned int frames;
+	// seconds between frame starts
+	double meanInterval;
+	// how far frame intervals were off the target interval (LIMITED) or off their mean (other modes)
+	double meanJitter;
+	double maxJitter;
+	// seconds spent waiting per frame
+	double sleepTime;
+	double spinTime;
+};
+
+// Starts frames on time without holding a core: LIMITED sleeps most of the way to the next frame
+// and spins only for the last FRAME_PACER_SPIN_MARGIN, the other modes leave the waiting to the
+// buffer swap (VSYNC, ADAPTIVE) or don't wait at all (UNCAPPED). Has no GL dependency; the caller
+// applies getSwapInterval().
+class FramePacer {
+	public:
+		enum Mode {
+			LIMITED,
+			VSYNC,
+			// vsync, but late frames swap right away instead of waiting a whole refresh
+			ADAPTIVE,
+			UNCAPPED
+		};
+
+		FramePacer();
+		~FramePacer();
+
+		void configure(Mode mode, double targetFps);
+		Mode getMode() const;
+		// what to pass to glfwSwapInterval() for the mode
+		int getSwapInterval() const;
+
+		// waits until the next frame is due and returns the seconds since the previous call
+		double waitForNextFrame();
+
+		// over the last FRAME_PACER_STATS_WINDOW frames
+		FramePacerStats getStats() const;
+
+		static const char* getModeName(Mode mode);
+		// false if name isn't one of the mode names
+		static bool parseMode(const char* name, Mode& mode);
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		Mode mode;
+		Clock::duration period;
+		Clock::time_point deadline;
+		Clock::time_point lastFrame;
+		bool started;
+
+		// ring buffers of the last frames
+		std::vector<double> intervals;
+		std::vector<double> sleeps;
+		std::vector<double> spins;
+		unsigned int statsNext;
+		unsigned int statsCount;
+		void record(double interval, double sleep, double spin);
+};
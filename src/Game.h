@@ -10,6 +10,11 @@
 
 #include "Camera.h"
 #include "Model.h"
+#include "Simulation.h"
+#include "SimulationClock.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+#include "TextureLoader.h"
 
 #include <queue>
 #include <map>
@@ -19,62 +24,43 @@
 const unsigned int SCR_WIDTH = 1600;
 const unsigned int SCR_HEIGHT = 900;
 const int TARGET_FPS = 144;
-const double MIN_TIME_PER_FRAME = 1.0 / (double)TARGET_FPS;
+// seconds between the pacing stats in the window title
+const double FRAME_STATS_INTERVAL = 1.0;
 
 const double PI = 3.14159265358979323846;
 
 // Game settings
-const unsigned int WAVES_VERTS_WIDTH_NUM = 5000;
+// the ocean is one patch of WAVES_TILE_QUADS^2 quads drawn instanced as clipmap tiles: a 4x4 block of
+// tiles at WAVES_VERTS_SCALE spacing around the camera, then rings of 12 tiles, each doubling the spacing
+const unsigned int WAVES_TILE_QUADS = 64;
+// ends a row strip in the patch's 16 bit index buffer
+const GLushort WAVES_PRIMITIVE_RESTART_INDEX = 0xFFFF;
+const unsigned int WAVES_LOD_LEVELS = 6;
 const float WAVES_VERTS_SCALE = 0.25f;
-const float WAVES_SPEEDS[4] = { 3.0f, 5.0f, 3.0f, 6.0f };
-const float WAVES_AMPLITUDES[4] = { 2.0f, 2.0f, 0.5f, 0.25f };
-//const float WAVES_LENGTH = 0.25f;
-const glm::vec3 WAVES_DIRECTIONS[4] = { glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(1.0f, 0.0f, 0.f), glm::vec3(-1.0f, 0.0f, -0.8f) };
-const float WAVES_LENGTHS[4] = { 20.0f, 10.0f, 5.0f, 2.5f };
-const float BOAT_HEIGHT_DAMPING_FACTOR = 0.95f;
-const float BOAT_HEIGHT_FLOATING_OFFSET = -0.5f;
-const float BOAT_HEIGHT_LERP_SPEED = 5.0f;
-const float BOAT_ROTATION_SPEED = 0.125f;
-const unsigned int WAVES_SAMPLE_GRID_SIZE = 5;
-const float WAVES_SAMPLE_SPACING = 0.25f;
-const unsigned int MAX_OTHER_BOATS_COUNT = 6;
-const unsigned int MAX_OTHER_BOATS_FOLLOW_COUNT = 1;
-const float MIN_OTHER_BOAT_START_DISTANCE_FROM_PLAYER = 50.0f;
-const float MAX_OTHER_BOAT_START_DISTANCE_FROM_PLAYER = 400.0f;
-const float MAX_OTHER_BOAT_DISTANCE_TO_CHANGE_DIRECTION = 600.0f;
-const float MIN_DISTANCE_BETWEEN_OTHER_BOATS = 45.0f;
-const float MIN_DISTANCE_FROM_PLAYER = 50.0f;
-const float OTHER_BOAT_SPEED = 8.0f;
-const float BOAT_COLLISION_DISTANCE = 28.0f;
-const float BOAT_FLIP_SPEED = 1.0f;
+// part of each ring's half width after which its vertices start blending into the next ring's grid
+const float WAVES_LOD_MORPH_START = 0.75f;
+// octaves with shorter wavelengths than this many vertices are dropped from a ring
+const float WAVES_LOD_MIN_VERTS_PER_WAVELENGTH = 4.0f;
+const glm::vec3 WATER_COLOR = glm::vec3(0.11372549019f, 0.63529411764f, 0.84705882352f);
+// uniform buffer binding points
+const GLuint FRAME_UNIFORMS_BINDING = 0;
+const GLuint WAVES_SPECTRUM_BINDING = 1;
+// the grid center moves in steps of two of the outermost ring's vertices, so every ring stays on its own grid
+const float WAVES_LOD_SNAP = 2.0f * WAVES_VERTS_SCALE * (float)(1 << (WAVES_LOD_LEVELS - 1));
+
+// first attribute location of the per-instance model matrix in vertex_instanced.vs
+const GLuint BOAT_INSTANCE_MODEL_LOCATION = 7;
+
+// Light settings
+const glm::vec3 DIR_LIGHT_DIRECTION = glm::vec3(-0.486897f, -0.0627906f, 0.8712f);
+const glm::vec3 DIR_LIGHT_AMBIENT = glm::vec3(0.4f);
+const glm::vec3 DIR_LIGHT_DIFFUSE = glm::vec3(0.6f);
+const glm::vec3 DIR_LIGHT_SPECULAR = glm::vec3(0.9f);
 
 // Player settings
 const float FOV = 60;
 const float FREE_CAM_FAST_MOVE_SPEED = 50;
 const float FREE_CAM_MOVE_SPEED = 10;
-const float CAM_LERP_SPEED = 10.0f;
-const float MAX_CAM_DISTANCE = 125.0f;
-const float MIN_CAM_DISTANCE = 20.0f;
-const float DEFAULT_CAM_DISTANCE = (MAX_CAM_DISTANCE - MIN_CAM_DISTANCE) * 0.5f + MIN_CAM_DISTANCE;
-const float BOAT_TURN_RATE = 0.5f;
-const float BOAT_SPEED = 12.0f;
-const float BOAT_DRAG = 5.0f;
-
-struct Boat {
-	Boat(): 
-		position(glm::vec3(0.0f)), forward(glm::vec3(0.0f, 0.0f, 1.0f)), right(glm::vec3(1.0f, 0.0f, 0.0f)), up(glm::vec3(0.0f, 1.0f, 0.0f)), 
-		currentBearing(glm::vec3(0.0f, 0.0f, 1.0f)), speed(0.0f), isFlipped(false), t_flip(0.0f), followPlayer(false), destDir(glm::vec3(0.0f, 0.0f, 1.0f)) {}
-	glm::vec3 position;
-	glm::vec3 forward;
-	glm::vec3 right;
-	glm::vec3 up;
-	glm::vec3 currentBearing;
-	float speed;
-	bool isFlipped;
-	float t_flip;
-	bool followPlayer;
-	glm::vec3 destDir;
-};
 
 struct BoxCollider {
 	BoxCollider(): ownerId(-1), offset(0.0f), size(1.0f) {}
@@ -90,74 +76,117 @@ struct Physics {
 	glm::vec3 acceleration;
 };
 
+// uniform locations of the values set every frame, looked up once after the shaders are linked
+struct ObjectUniforms {
+	GLint model;
+	MeshUniforms mesh;
+};
+
+struct WavesUniforms {
+	GLint camOffset;
+	GLint model;
+};
+
+// the FrameUniforms block every shader gets (FRAME_UNIFORMS_GLSL), std140: vec3s take 16 bytes
+struct FrameUniforms {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec3 viewPos;
+	float time;
+	glm::vec4 dirLightDirection;
+	glm::vec4 dirLightAmbient;
+	glm::vec4 dirLightDiffuse;
+	glm::vec4 dirLightSpecular;
+};
+static_assert(sizeof(FrameUniforms) == 272, "FrameUniforms must match the std140 layout of the GLSL block");
+// the GLSL side of FrameUniforms, inserted into every shader stage after its #version line
+const char* const FRAME_UNIFORMS_GLSL =
+	"struct DirLight {\n"
+	"    vec3 direction;\n"
+	"    vec3 ambient;\n"
+	"    vec3 diffuse;\n"
+	"    vec3 specular;\n"
+	"};\n"
+	"layout (std140) uniform FrameUniforms {\n"
+	"    mat4 view;\n"
+	"    mat4 projection;\n"
+	"    mat4 viewProjection;\n"
+	"    vec3 viewPos;\n"
+	"    float time;\n"
+	"    DirLight dirLight;\n"
+	"};\n";
+
 class Game {
 	private:
 		Shader wavesShader;
 		Shader outlineShader;
 		Shader skyboxShader;
 		Shader objectShader;
-		Shader flatShader;
+		Shader boatInstanceShader;
 
-		GLuint cubeVAO, cubeVBO, cubeEBO;
+		ObjectUniforms objectUniforms;
+		MeshUniforms boatInstanceUniforms;
+		WavesUniforms wavesUniforms;
+		void initUniformLocations();
+
+		// camera, light and time for every shader, written once per frame
+		FrameUniforms frameUniforms;
+		GLuint frameUBO;
+		void initFrameUniforms();
+		void uploadFrameUniforms();
 
 		unsigned int cubeMapTexture;
 		GLuint skyboxVAO, skyboxVBO, skyboxEBO;
 		GLuint outlineVAO, outlineVBO, outlineEBO;
 
-		unsigned int wavesStripCount, wavesVertsPerStrip;
-		GLuint wavesVAO, wavesVBO, wavesEBO;
-		float wavesTime;
-		glm::vec3 waveDirections[12];
+		unsigned int wavesIndexCount, wavesTileCount;
+		GLuint wavesVAO, wavesVBO, wavesEBO, wavesTileVBO;
+		GLuint wavesSpectrumUBO;
 
 		glm::mat4 boatToWorld;
 
+		// before boatModel, which queues its textures on it
+		TextureLoader textureLoader;
 		Model boatModel;
-		glm::vec3 boatPosition;
-		glm::vec3 boatForward;
-		glm::vec3 boatRight;
-		glm::vec3 boatUp;
-
-		glm::vec3 currentBoatBearing;
-		float boatSpeed;
 
-		std::vector<Boat> otherBoats;
+		Simulation simulation;
+		// the simulation runs in fixed steps; frames draw a blend of the last two steps
+		SimulationClock simulationClock;
+		SimulationSnapshot previousStep;
+		SimulationSnapshot latestStep;
+		SimulationSnapshot frame;
+		// restarts the blend from the current state, for jumps that shouldn't be smoothed over
+		void resetSteps();
 
-		float dt;
-
-		Camera freeCamera;
-		Camera boatCamera;
-		Camera* currentCamera;
-		float boatCameraDistance;
-		float boatCameraHeight;
 		bool isAdjustingHeight;
-		void updateBoatCamera();
+
+		GpuProfiler gpuProfiler;
 		
 		std::map<unsigned int, bool> keyDown;
 		bool handleKeyDown(GLFWwindow* window, unsigned int key);
 
-		void initOtherBoats();
-		void updateOtherBoats();
+		// AI boats share boatModel and are drawn instanced, their model matrices streamed in every frame
+		std::vector<glm::mat4> boatInstances;
+		GLuint boatInstanceVBO;
+		void initBoatInstances();
 		void renderOtherBoats();
+		// the player boat and the AI boats
+		void renderBoats();
 
 		void initSkybox();
 		void drawSkybox();
 
 		void initWaves();
+		// wave parameters are constant between simulation.init() calls, so they are uploaded once into
+		// the WaveSpectrumBlock uniform buffer; call again whenever the spectrum changes
+		void uploadWaveSpectrum();
+		void initWavesMaterial();
 		void drawWaves();
 
 		void initColliderOutline();
 		void init();
 
-		void initCube();
-		void drawCube();
-
-		glm::vec3 getBoatPositionFromWaves(glm::vec3 position, glm::vec3& normal);
-		glm::vec3 getAverageBoatPositionFromWaves(glm::vec3& normal);
-		glm::vec3 getAverageBoatPositionFromWaves(glm::vec3 position, glm::vec3& normal);
-
-		void moveBoat(glm::vec3 direction);
-		void moveBoat(Boat& boat, glm::vec3 direction);
-
 		glm::mat4 getProjection() const;
 
 		void accelerate(Physics& phys, glm::vec3 a);
@@ -172,6 +201,18 @@ class Game {
 		
 		void render(float dt);
 		void update(float dt);
+		// textures decode in the background and show a placeholder until uploaded; this waits for all of them
+		void finishLoading();
+
+		// threads besides the main one for the simulation jobs, JOB_THREADS_AUTO for one per spare hardware thread
+		void setJobThreads(unsigned int workerCount);
+		// simulation steps per second, independent of the frame rate
+		void setSimulationRate(float rate);
+		float getSimulationStep() const;
+
+		// restarts the simulation from a fixed seed with otherBoatsCount AI boats
+		void reset(unsigned int seed, unsigned int otherBoatsCount);
+		Simulation& getSimulation();
 
 		void processMouseMovement(float xoffset, float yoffset, GLboolean constrainPitch = true);
 		void processMouseScroll(float yoffset);
@@ -0,0 +1,44 @@
+#include "GpuProfiler.h"
+
+GpuProfiler::GpuProfiler() : current(0), open(false)
+{
+}
+
+void GpuProfiler::beginFrame() {
+    current = (current + 1) % GPU_PROFILER_FRAMES_IN_FLIGHT;
+    // the queries of this slot were issued GPU_PROFILER_FRAMES_IN_FLIGHT frames ago
+    collect(frames[current]);
+}
+
+void GpuProfiler::collect(Frame& frame) {
+    for (unsigned int i = 0; i < frame.used; i++) {
+        Zone& zone = frame.zones[i];
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(zone.query, GL_QUERY_RESULT, &elapsed);
+        Profiler::recordGpu(zone.name, zone.cpuStart, zone.cpuStart + elapsed);
+    }
+    frame.used = 0;
+}
+
+bool GpuProfiler::begin(const char* name) {
+    if (!Profiler::isEnabled() || open) return false;
+
+    Frame& frame = frames[current];
+    if (frame.used == frame.zones.size()) {
+        Zone zone;
+        glGenQueries(1, &zone.query);
+        frame.zones.push_back(zone);
+    }
+    Zone& zone = frame.zones[frame.used++];
+    zone.name = name;
+    zone.cpuStart = Profiler::now();
+    glBeginQuery(GL_TIME_ELAPSED, zone.query);
+    open = true;
+    return true;
+}
+
+void GpuProfiler::end() {
+    if (!open) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    open = false;
+}
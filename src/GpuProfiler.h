@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "Profiler.h"
+
+#include <vector>
+
+// GPU profiler settings
+// frames between issuing a query and reading it back, so reading never waits on the GPU
+const unsigned int GPU_PROFILER_FRAMES_IN_FLIGHT = 4;
+
+// GL_TIME_ELAPSED queries around GPU passes, read back GPU_PROFILER_FRAMES_IN_FLIGHT frames later and
+// handed to Profiler::recordGpu(), placed at the CPU time the pass was issued. Elapsed time queries
+// can't overlap, so a zone opened inside another one is skipped. Records nothing while the Profiler is disabled.
+class GpuProfiler {
+	public:
+		GpuProfiler();
+
+		// call once per frame before the first zone, with the GL context current
+		void beginFrame();
+
+		// false if nothing was started (profiler disabled or a zone already open)
+		bool begin(const char* name);
+		void end();
+
+	private:
+		struct Zone {
+			const char* name;
+			GLuint query;
+			uint64_t cpuStart;
+		};
+
+		// queries of one frame; the GL query objects are kept and reused once read back
+		struct Frame {
+			Frame(): used(0) {}
+			std::vector<Zone> zones;
+			unsigned int used;
+		};
+
+		Frame frames[GPU_PROFILER_FRAMES_IN_FLIGHT];
+		unsigned int current;
+		bool open;
+
+		void collect(Frame& frame);
+};
+
+// times the GPU work issued in the enclosing scope
+class GpuZone {
+	public:
+		GpuZone(GpuProfiler& profiler, const char* name) : profiler(profiler), started(profiler.begin(name)) {}
+		~GpuZone() {
+			if (started) profiler.end();
+		}
+
+	private:
+		GpuProfiler& profiler;
+		bool started;
+};
@@ -0,0 +1,136 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+JobSystem::JobSystem() : pending(0), stopping(false)
+{
+    queues.emplace_back(new Queue());
+}
+
+JobSystem::~JobSystem() {
+    stop();
+}
+
+unsigned int JobSystem::getDefaultWorkerCount() {
+    unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+void JobSystem::start(unsigned int workerCount) {
+    stop();
+
+    queues.clear();
+    for (unsigned int i = 0; i <= workerCount; i++) {
+        queues.emplace_back(new Queue());
+    }
+
+    stopping = false;
+    for (unsigned int i = 1; i <= workerCount; i++) {
+        threads.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+void JobSystem::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    threads.clear();
+}
+
+unsigned int JobSystem::getWorkerCount() const {
+    return (unsigned int)threads.size();
+}
+
+unsigned int JobSystem::getSlotCount() const {
+    return (unsigned int)queues.size();
+}
+
+void JobSystem::parallelFor(unsigned int count, unsigned int grain, const RangeJob& job) {
+    if (count == 0) return;
+    if (grain == 0) grain = 1;
+
+    // a single chunk isn't worth waking anyone for
+    if (threads.empty() || count <= grain) {
+        for (unsigned int begin = 0; begin < count; begin += grain) {
+            job(begin, count - begin < grain ? count : begin + grain, 0);
+        }
+        return;
+    }
+
+    unsigned int chunkCount = (count + grain - 1) / grain;
+    std::atomic<unsigned int> remaining(chunkCount);
+
+    // consecutive chunks go to the same queue, so a thread working its own queue walks through memory in order
+    unsigned int slotCount = (unsigned int)queues.size();
+    for (unsigned int slot = 0; slot < slotCount; slot++) {
+        unsigned int firstChunk = chunkCount * slot / slotCount;
+        unsigned int lastChunk = chunkCount * (slot + 1) / slotCount;
+        if (firstChunk == lastChunk) continue;
+
+        Queue& queue = *queues[slot];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        // pushed back to front, so the owner popping from the back starts with the lowest chunk
+        for (unsigned int chunk = lastChunk; chunk-- > firstChunk;) {
+            unsigned int begin = chunk * grain;
+            Task task = { &job, begin, count - begin < grain ? count : begin + grain, &remaining };
+            queue.tasks.push_back(task);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        pending += (int)chunkCount;
+    }
+    wake.notify_all();
+
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (!runOne(0)) std::this_thread::yield();
+    }
+}
+
+bool JobSystem::popOwn(unsigned int slot, Task& task) {
+    Queue& queue = *queues[slot];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool JobSystem::steal(unsigned int slot, Task& task) {
+    unsigned int slotCount = (unsigned int)queues.size();
+    for (unsigned int offset = 1; offset < slotCount; offset++) {
+        Queue& queue = *queues[(slot + offset) % slotCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::runOne(unsigned int slot) {
+    Task task;
+    if (!popOwn(slot, task) && !steal(slot, task)) return false;
+    pending--;
+
+    (*task.job)(task.begin, task.end, slot);
+    task.remaining->fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void JobSystem::workerLoop(unsigned int slot) {
+    Profiler::setThreadName("job worker");
+    while (true) {
+        if (runOne(slot)) continue;
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wake.wait(lock, [this]() { return stopping || pending.load() > 0; });
+        if (stopping) return;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 0 = one worker per hardware thread besides the caller
+const unsigned int JOB_THREADS_AUTO = 0;
+
+// Small work-stealing thread pool for data parallel passes. parallelFor() cuts a range into fixed
+// chunks, deals them out over per-thread queues and returns once all of them ran, so consecutive
+// calls act as barriers. Idle threads take from the back of their own queue and steal from the
+// front of the others. The calling thread works through the chunks too.
+//
+// Chunk boundaries depend only on the range and the grain, never on the thread count, so a job that
+// writes nothing but its own elements gives the same result on any pool size.
+class JobSystem {
+	public:
+		// begin/end of the chunk, and the slot of the thread running it (0 = caller, 1.. = workers),
+		// for indexing per-thread scratch buffers
+		typedef std::function<void(unsigned int begin, unsigned int end, unsigned int slot)> RangeJob;
+
+		JobSystem();
+		~JobSystem();
+
+		// (re)starts the pool with workerCount threads besides the caller; 0 workers runs every job inline
+		void start(unsigned int workerCount);
+		void stop();
+
+		unsigned int getWorkerCount() const;
+		// distinct slots passed to jobs: the workers plus the caller
+		unsigned int getSlotCount() const;
+
+		// runs job over [0, count) in chunks of grain elements, blocking until every chunk finished.
+		// Only call it from the thread that started the pool
+		void parallelFor(unsigned int count, unsigned int grain, const RangeJob& job);
+
+		// workers for JOB_THREADS_AUTO
+		static unsigned int getDefaultWorkerCount();
+
+	private:
+		struct Task {
+			const RangeJob* job;
+			unsigned int begin;
+			unsigned int end;
+			std::atomic<unsigned int>* remaining;
+		};
+
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		// one queue per slot
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> threads;
+
+		std::mutex wakeMutex;
+		std::condition_variable wake;
+		// queued and not yet taken, only increased under wakeMutex so a sleeping worker can't miss it.
+		// Signed, as a task can be taken before its increase lands
+		std::atomic<int> pending;
+		bool stopping;
+
+		bool popOwn(unsigned int slot, Task& task);
+		bool steal(unsigned int slot, Task& task);
+		// runs one task from slot's queue or stolen from another one, false if all queues are empty
+		bool runOne(unsigned int slot);
+		void workerLoop(unsigned int slot);
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 64 bit FNV-1a of size bytes, for telling whether a cached file is still up to date with its source
+uint64_t hashBytes(const unsigned char* data, size_t size);
+
+// Read-only view of a whole file: memory mapped where the platform supports it, read into memory otherwise.
+// The view stays valid until close() or destruction.
+class MappedFile {
+	public:
+		MappedFile();
+		~MappedFile();
+
+		// false if the file can't be opened, empty files open with size() 0
+		bool open(const std::string& path);
+		void close();
+
+		bool isOpen() const { return opened; }
+		const unsigned char* data() const { return bytes; }
+		size_t size() const { return length; }
+
+	private:
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+		const unsigned char* bytes;
+		size_t length;
+		bool opened;
+		bool mapped;
+		// fallback when mapping fails
+		std::vector<unsigned char> buffer;
+#ifdef _WIN32
+		void* fileHandle;
+		void* mappingHandle;
+#endif
+};
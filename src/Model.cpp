@@ -1,33 +1,74 @@
 #include "Model.h"
 
-Model::Model(string const& path, bool gamma) : gammaCorrection(gamma)
+// assimp post processing of every import, stored in the model cache so changing it re-imports
+static const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace;
+
+Model::Model(string const& path, bool gamma, unsigned int vertexFlags, TextureLoader* textureLoader) : gammaCorrection(gamma),
+    vertexFlags(vertexFlags), textureLoader(textureLoader)
 {
     loadModel(path);
 }
 
-void Model::Draw(Shader& shader)
+void Model::Draw(Shader& shader, const MeshUniforms& uniforms)
 {
     for (unsigned int i = 0; i < meshes.size(); i++)
-        meshes[i].Draw(shader);
+        meshes[i].Draw(shader, uniforms);
+}
+
+void Model::DrawInstanced(Shader& shader, const MeshUniforms& uniforms, unsigned int instanceCount)
+{
+    if (instanceCount == 0)
+        return;
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        meshes[i].DrawInstanced(shader, uniforms, instanceCount);
+}
+
+void Model::setInstanceBuffer(unsigned int buffer, unsigned int firstLocation)
+{
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        meshes[i].setInstanceBuffer(buffer, firstLocation);
 }
 
 void Model::loadModel(string const& path)
 {
+    // retrieve the directory path of the filepath
+    directory = path.substr(0, path.find_last_of('/'));
+
+    // an up to date cache skips the import entirely
+    ModelCache cache(path, MODEL_IMPORT_FLAGS, vertexFlags);
+    if (cache.load())
+    {
+        loadCachedModel(cache);
+        return;
+    }
+
     // read file via ASSIMP
     Assimp::Importer importer;
     //const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+    const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
     // check for errors
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
     {
         cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
         return;
     }
-    // retrieve the directory path of the filepath
-    directory = path.substr(0, path.find_last_of('/'));
 
     // process ASSIMP's root node recursively
     processNode(scene->mRootNode, scene);
+    cache.save(meshes);
+}
+
+void Model::loadCachedModel(const ModelCache& cache)
+{
+    const vector<ModelCacheMesh>& cached = cache.getMeshes();
+    meshes.reserve(cached.size());
+    for (unsigned int i = 0; i < cached.size(); i++)
+    {
+        vector<Texture> textures;
+        for (unsigned int j = 0; j < cached[i].textures.size(); j++)
+            textures.push_back(loadTexture(cached[i].textures[j].path.c_str(), cached[i].textures[j].type));
+        meshes.push_back(Mesh(cached[i].format, cached[i].vertexData, cached[i].vertexCount, cached[i].indices, cached[i].indexCount, textures));
+    }
 }
 
 void Model::processNode(aiNode* node, const aiScene* scene)
@@ -58,7 +99,7 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
     // walk through each of the mesh's vertices
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
-        Vertex vertex;
+        Vertex vertex = {}; // zeroed, so the unused bone fields don't put garbage into the cache
         glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
         // positions
         vector.x = mesh->mVertices[i].x;
@@ -129,7 +170,7 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
     textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
     // return a mesh object created from the extracted mesh data
-    return Mesh(vertices, indices, textures);
+    return Mesh(vertices, indices, textures, vertexFlags);
 }
 
 vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
@@ -139,30 +180,32 @@ vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type,
     {
         aiString str;
         mat->GetTexture(type, i, &str);
-        // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-        bool skip = false;
-        for (unsigned int j = 0; j < textures_loaded.size(); j++)
-        {
-            if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-            {
-                textures.push_back(textures_loaded[j]);
-                skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                break;
-            }
-        }
-        if (!skip)
-        {   // if texture hasn't been loaded already, load it
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), this->directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
-        }
+        textures.push_back(loadTexture(str.C_Str(), typeName));
     }
     return textures;
 }
 
+Texture Model::loadTexture(const char* path, const string& typeName)
+{
+    // check if texture was loaded before and if so, skip loading a new texture
+    for (unsigned int j = 0; j < textures_loaded.size(); j++)
+    {
+        if (std::strcmp(textures_loaded[j].path.data(), path) == 0)
+            return textures_loaded[j]; // a texture with the same filepath has already been loaded (optimization)
+    }
+    // if texture hasn't been loaded already, load it
+    Texture texture;
+    // model textures are flipped to OpenGL's bottom-up rows
+    if (textureLoader)
+        texture.id = textureLoader->load2D(this->directory + '/' + path, true);
+    else
+        texture.id = TextureFromFile(path, this->directory);
+    texture.type = typeName;
+    texture.path = path;
+    textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+    return texture;
+}
+
 unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
 {
     string filename = string(path);
@@ -10,7 +10,10 @@
 #include <assimp/postprocess.h>
 
 #include <learnopengl/mesh.h>
-#include <learnopengl/shader.h>
+#include <learnopengl/shader_m.h>
+
+#include "ModelCache.h"
+#include "TextureLoader.h"
 
 #include <string>
 #include <fstream>
@@ -30,17 +33,29 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // optional VertexFormatFlags asked of every mesh, the rest is chosen per mesh
+    unsigned int vertexFlags;
+    // decodes the textures in the background when set, they're loaded with TextureFromFile otherwise
+    TextureLoader* textureLoader;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const& path, bool gamma = false);
+    Model(string const& path, bool gamma = false, unsigned int vertexFlags = 0, TextureLoader* textureLoader = NULL);
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader& shader);
+    // draws the model, and thus all its meshes; see Mesh::Draw for what the shader needs
+    void Draw(Shader& shader, const MeshUniforms& uniforms);
+    // one instanced draw per mesh, with the model matrices from setInstanceBuffer()
+    void DrawInstanced(Shader& shader, const MeshUniforms& uniforms, unsigned int instanceCount);
+    // per-instance mat4 source for DrawInstanced, read from attribute locations firstLocation to firstLocation + 3
+    void setInstanceBuffer(unsigned int buffer, unsigned int firstLocation);
 
 private:
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    // uses the binary cache next to the file when it's up to date, and writes it after an import otherwise.
     void loadModel(string const& path);
 
+    // builds the meshes from a loaded cache, uploading straight from the mapped file
+    void loadCachedModel(const ModelCache& cache);
+
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
     void processNode(aiNode* node, const aiScene* scene);
 
@@ -49,4 +64,7 @@ private:
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
     // the required info is returned as a Texture struct.
     vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName);
+
+    // the texture at path (relative to directory), loaded unless textures_loaded already has it
+    Texture loadTexture(const char* path, const string& typeName);
 };
\ No newline at end of file
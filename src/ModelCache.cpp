@@ -0,0 +1,213 @@
+#include "ModelCache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+const char CACHE_MAGIC[4] = { 'W', 'M', 'C', 'H' };
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t importFlags;
+    uint32_t vertexFlags;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint32_t meshCount;
+    uint32_t padding;
+};
+
+// followed by the texture references, then vertexCount packed vertices and indexCount indices
+struct CacheMeshHeader {
+    uint32_t formatFlags;
+    float positionOffset[3];
+    float positionScale[3];
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t textureCount;
+};
+
+// strings are padded so the arrays after them stay 4 byte aligned
+size_t padded(size_t bytes) {
+    return (bytes + 3) & ~(size_t)3;
+}
+
+// bounds checked walk over the mapped file
+struct CacheReader {
+    CacheReader(const unsigned char* data, size_t size) : data(data), size(size), offset(0) {}
+    const unsigned char* data;
+    size_t size;
+    size_t offset;
+
+    const unsigned char* take(size_t bytes) {
+        if (bytes > size - offset) return NULL;
+        const unsigned char* result = data + offset;
+        offset += padded(bytes);
+        if (offset > size) offset = size;
+        return result;
+    }
+    // whether count elements of at least elementSize bytes each could still be in the file, checked
+    // before sizing anything from a count the file claims
+    bool canHold(uint32_t count, size_t elementSize) const {
+        return count <= (size - offset) / elementSize;
+    }
+    template <typename T>
+    bool read(T& value) {
+        const unsigned char* bytes = take(sizeof(T));
+        if (bytes == NULL) return false;
+        memcpy(&value, bytes, sizeof(T));
+        return true;
+    }
+    bool readString(std::string& value, uint32_t length) {
+        const unsigned char* bytes = take(length);
+        if (bytes == NULL) return false;
+        value.assign((const char*)bytes, length);
+        return true;
+    }
+};
+
+void writePadding(std::ofstream& out, size_t bytes) {
+    const char zeros[4] = { 0, 0, 0, 0 };
+    out.write(zeros, padded(bytes) - bytes);
+}
+
+}
+
+ModelCache::ModelCache(const std::string& sourcePath, uint32_t importFlags, uint32_t vertexFlags) : sourcePath(sourcePath),
+    cachePath(sourcePath + MODEL_CACHE_EXTENSION), importFlags(importFlags), vertexFlags(vertexFlags), sourceHashed(false), sourceSize(0), sourceHash(0)
+{
+}
+
+bool ModelCache::hashSource() {
+    if (sourceHashed) return true;
+    MappedFile source;
+    if (!source.open(sourcePath)) return false;
+    sourceSize = source.size();
+    sourceHash = hashBytes(source.data(), source.size());
+    sourceHashed = true;
+    return true;
+}
+
+bool ModelCache::load() {
+    release();
+    if (!hashSource() || !file.open(cachePath)) return false;
+
+    CacheReader reader(file.data(), file.size());
+    CacheHeader header;
+    if (!reader.read(header) || memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != MODEL_CACHE_VERSION
+        || header.importFlags != importFlags || header.vertexFlags != vertexFlags || header.sourceSize != sourceSize || header.sourceHash != sourceHash) {
+        release();
+        return false;
+    }
+
+    if (!reader.canHold(header.meshCount, sizeof(CacheMeshHeader))) {
+        std::cout << "Model cache is damaged: " << cachePath << std::endl;
+        release();
+        return false;
+    }
+    meshes.resize(header.meshCount);
+    for (uint32_t m = 0; m < header.meshCount; m++) {
+        ModelCacheMesh& mesh = meshes[m];
+        CacheMeshHeader meshHeader;
+        bool valid = reader.read(meshHeader) && reader.canHold(meshHeader.textureCount, 2 * sizeof(uint32_t));
+        if (valid) mesh.textures.resize(meshHeader.textureCount);
+        for (uint32_t t = 0; valid && t < meshHeader.textureCount; t++) {
+            uint32_t lengths[2];
+            valid = reader.read(lengths) && reader.readString(mesh.textures[t].type, lengths[0]) && reader.readString(mesh.textures[t].path, lengths[1]);
+        }
+        const unsigned char* vertices = valid ? reader.take((size_t)meshHeader.vertexCount * getVertexLayout(meshHeader.formatFlags).stride) : NULL;
+        const unsigned char* indices = vertices != NULL ? reader.take((size_t)meshHeader.indexCount * sizeof(unsigned int)) : NULL;
+        if (indices == NULL) {
+            std::cout << "Model cache is damaged: " << cachePath << std::endl;
+            release();
+            return false;
+        }
+        mesh.format.flags = meshHeader.formatFlags;
+        mesh.format.positionOffset = glm::vec3(meshHeader.positionOffset[0], meshHeader.positionOffset[1], meshHeader.positionOffset[2]);
+        mesh.format.positionScale = glm::vec3(meshHeader.positionScale[0], meshHeader.positionScale[1], meshHeader.positionScale[2]);
+        mesh.vertexData = vertices;
+        mesh.vertexCount = meshHeader.vertexCount;
+        mesh.indices = (const unsigned int*)indices;
+        mesh.indexCount = meshHeader.indexCount;
+    }
+    return true;
+}
+
+void ModelCache::release() {
+    meshes.clear();
+    file.close();
+}
+
+bool ModelCache::save(const std::vector<Mesh>& meshes) {
+    if (!hashSource()) return false;
+
+    // written aside and renamed over, so an instance starting meanwhile never maps half a file; the name is
+    // per thread and time, as another instance may be importing the same model
+    std::string tempPath = cachePath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()) ^ (size_t)std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream out(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cout << "Failed to write model cache: " << cachePath << std::endl;
+            return false;
+        }
+
+        CacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.version = MODEL_CACHE_VERSION;
+        header.importFlags = importFlags;
+        header.vertexFlags = vertexFlags;
+        header.sourceSize = sourceSize;
+        header.sourceHash = sourceHash;
+        header.meshCount = (uint32_t)meshes.size();
+        out.write((const char*)&header, sizeof(header));
+
+        for (unsigned int m = 0; m < meshes.size(); m++) {
+            const Mesh& mesh = meshes[m];
+            CacheMeshHeader meshHeader;
+            memset(&meshHeader, 0, sizeof(meshHeader));
+            meshHeader.formatFlags = mesh.format.flags;
+            for (int axis = 0; axis < 3; axis++) {
+                meshHeader.positionOffset[axis] = mesh.format.positionOffset[axis];
+                meshHeader.positionScale[axis] = mesh.format.positionScale[axis];
+            }
+            meshHeader.vertexCount = mesh.vertexCount;
+            meshHeader.indexCount = (uint32_t)mesh.indices.size();
+            meshHeader.textureCount = (uint32_t)mesh.textures.size();
+            out.write((const char*)&meshHeader, sizeof(meshHeader));
+
+            for (unsigned int t = 0; t < mesh.textures.size(); t++) {
+                const Texture& texture = mesh.textures[t];
+                uint32_t lengths[2] = { (uint32_t)texture.type.size(), (uint32_t)texture.path.size() };
+                out.write((const char*)lengths, sizeof(lengths));
+                out.write(texture.type.data(), texture.type.size());
+                writePadding(out, texture.type.size());
+                out.write(texture.path.data(), texture.path.size());
+                writePadding(out, texture.path.size());
+            }
+            out.write((const char*)mesh.vertexData.data(), mesh.vertexData.size());
+            out.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+        }
+
+        if (!out) {
+            std::cout << "Failed to write model cache: " << cachePath << std::endl;
+            out.close();
+            remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    // rename doesn't replace an existing file everywhere
+    remove(cachePath.c_str());
+    if (rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::cout << "Failed to write model cache: " << cachePath << std::endl;
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <learnopengl/mesh.h>
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Model cache settings
+// bump whenever the file layout or the packed vertex formats change
+const uint32_t MODEL_CACHE_VERSION = 2;
+// written next to the source model
+const char* const MODEL_CACHE_EXTENSION = ".meshcache";
+
+// texture reference of a cached mesh, resolved by the Model like the ones of an imported material
+struct ModelCacheTexture {
+	std::string type;
+	std::string path;
+};
+
+// one mesh of the cache, vertexData (packed in format) and indices point into the mapped file
+struct ModelCacheMesh {
+	VertexFormat format;
+	const unsigned char* vertexData;
+	unsigned int vertexCount;
+	const unsigned int* indices;
+	unsigned int indexCount;
+	std::vector<ModelCacheTexture> textures;
+};
+
+// Binary copy of an imported model: per mesh its vertex format, packed vertices, indices and texture references.
+// It's only used if it was written by the same MODEL_CACHE_VERSION, import flags and requested vertex flags from
+// a source file with the same size and FNV-1a hash, so editing the model re-imports it.
+class ModelCache {
+	public:
+		ModelCache(const std::string& sourcePath, uint32_t importFlags, uint32_t vertexFlags);
+
+		// maps the cache file, false if it's missing, stale or damaged
+		bool load();
+		const std::vector<ModelCacheMesh>& getMeshes() const { return meshes; }
+		// unmaps the file, the mesh pointers are invalid after this
+		void release();
+
+		// replaces the cache file with meshes
+		bool save(const std::vector<Mesh>& meshes);
+
+	private:
+		std::string sourcePath;
+		std::string cachePath;
+		uint32_t importFlags;
+		uint32_t vertexFlags;
+
+		bool sourceHashed;
+		uint64_t sourceSize;
+		uint64_t sourceHash;
+		bool hashSource();
+
+		MappedFile file;
+		std::vector<ModelCacheMesh> meshes;
+};
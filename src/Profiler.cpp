@@ -0,0 +1,226 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+namespace {
+
+struct ProfileEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    unsigned int frame;
+};
+
+struct ProfileRing {
+    ProfileRing(const std::string& name, bool gpu) : name(name), gpu(gpu), inUse(true), events(PROFILER_RING_CAPACITY), written(0) {}
+    std::string name;
+    bool gpu;
+    // false once the owning thread exited, the next new thread takes it over
+    bool inUse;
+    std::vector<ProfileEvent> events;
+    std::atomic<uint64_t> written;
+};
+
+std::atomic<bool> profilerEnabled(false);
+std::atomic<unsigned int> currentFrame(0);
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+// rings are never freed, so reading them needs no lock once the list is copied
+std::mutex ringsMutex;
+std::vector<ProfileRing*> rings;
+
+ProfileRing* acquireRing() {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    for (unsigned int i = 0; i < rings.size(); i++) {
+        if (!rings[i]->gpu && !rings[i]->inUse) {
+            rings[i]->inUse = true;
+            rings[i]->name = "thread " + std::to_string(i);
+            return rings[i];
+        }
+    }
+    rings.push_back(new ProfileRing("thread " + std::to_string(rings.size()), false));
+    return rings.back();
+}
+
+struct ThreadRing {
+    ThreadRing() : ring(nullptr) {}
+    ~ThreadRing() {
+        if (ring == nullptr) return;
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        ring->inUse = false;
+    }
+    ProfileRing* get() {
+        if (ring == nullptr) ring = acquireRing();
+        return ring;
+    }
+    ProfileRing* ring;
+};
+
+thread_local ThreadRing threadRing;
+
+ProfileRing* gpuRing() {
+    static ProfileRing* ring = nullptr;
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    if (ring == nullptr) {
+        ring = new ProfileRing("GPU", true);
+        rings.push_back(ring);
+    }
+    return ring;
+}
+
+void push(ProfileRing* ring, const char* name, uint64_t start, uint64_t end) {
+    uint64_t index = ring->written.load(std::memory_order_relaxed);
+    ProfileEvent& event = ring->events[index % PROFILER_RING_CAPACITY];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    event.frame = currentFrame.load(std::memory_order_relaxed);
+    ring->written.store(index + 1, std::memory_order_release);
+}
+
+std::vector<ProfileRing*> copyRings() {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    return rings;
+}
+
+// nearest rank
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = (size_t)ceil(p * (double)sorted.size());
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+void writeJsonString(std::ostream& out, const std::string& s) {
+    out << '"';
+    for (unsigned int i = 0; i < s.size(); i++) {
+        if (s[i] == '"' || s[i] == '\\') out << '\\';
+        out << s[i];
+    }
+    out << '"';
+}
+
+}
+
+void Profiler::setEnabled(bool enabled) {
+    profilerEnabled = enabled;
+}
+
+bool Profiler::isEnabled() {
+    return profilerEnabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::beginFrame() {
+    currentFrame++;
+}
+
+unsigned int Profiler::getFrame() {
+    return currentFrame.load(std::memory_order_relaxed);
+}
+
+uint64_t Profiler::now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::setThreadName(const char* name) {
+    ProfileRing* ring = threadRing.get();
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    ring->name = name;
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end) {
+    push(threadRing.get(), name, start, end);
+}
+
+void Profiler::recordGpu(const char* name, uint64_t start, uint64_t end) {
+    push(gpuRing(), name, start, end);
+}
+
+void Profiler::getSummary(std::vector<ProfileZoneStats>& stats, unsigned int frames) {
+    stats.clear();
+    unsigned int frame = getFrame();
+
+    // by (gpu, name), so CPU zones come first
+    std::map<std::pair<bool, std::string>, std::vector<double>> durations;
+    std::vector<ProfileRing*> allRings = copyRings();
+    for (unsigned int r = 0; r < allRings.size(); r++) {
+        const ProfileRing& ring = *allRings[r];
+        uint64_t written = ring.written.load(std::memory_order_acquire);
+        uint64_t first = written > PROFILER_RING_CAPACITY ? written - PROFILER_RING_CAPACITY : 0;
+        for (uint64_t i = first; i < written; i++) {
+            const ProfileEvent& event = ring.events[i % PROFILER_RING_CAPACITY];
+            if (frame - event.frame >= frames) continue;
+            durations[std::make_pair(ring.gpu, std::string(event.name))].push_back((double)(event.end - event.start) * 1e-6);
+        }
+    }
+
+    for (auto it = durations.begin(); it != durations.end(); ++it) {
+        std::vector<double>& values = it->second;
+        std::sort(values.begin(), values.end());
+
+        ProfileZoneStats zone;
+        zone.name = it->first.second;
+        zone.gpu = it->first.first;
+        zone.count = (unsigned int)values.size();
+        zone.mean = 0.0;
+        for (unsigned int i = 0; i < values.size(); i++) {
+            zone.mean += values[i];
+        }
+        zone.mean /= (double)values.size();
+        zone.p50 = percentile(values, 0.50);
+        zone.p95 = percentile(values, 0.95);
+        zone.p99 = percentile(values, 0.99);
+        zone.max = values.back();
+        stats.push_back(zone);
+    }
+}
+
+void Profiler::writeSummary(std::ostream& out, unsigned int frames) {
+    std::vector<ProfileZoneStats> stats;
+    getSummary(stats, frames);
+
+    out << "zone timings over the last " << frames << " frames (ms): count mean p50 p95 p99 max" << std::endl;
+    for (unsigned int i = 0; i < stats.size(); i++) {
+        const ProfileZoneStats& zone = stats[i];
+        out << "  " << (zone.gpu ? "gpu " : "cpu ") << zone.name << ": " << zone.count << " " << zone.mean << " "
+            << zone.p50 << " " << zone.p95 << " " << zone.p99 << " " << zone.max << std::endl;
+    }
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+    std::ofstream out(path.c_str());
+    if (!out) {
+        std::cout << "Failed to write trace: " << path << std::endl;
+        return false;
+    }
+
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+
+    std::vector<ProfileRing*> allRings = copyRings();
+    for (unsigned int r = 0; r < allRings.size(); r++) {
+        const ProfileRing& ring = *allRings[r];
+        out << (first ? "\n" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << r << ",\"args\":{\"name\":";
+        writeJsonString(out, ring.name);
+        out << "}}";
+        first = false;
+
+        uint64_t written = ring.written.load(std::memory_order_acquire);
+        uint64_t begin = written > PROFILER_RING_CAPACITY ? written - PROFILER_RING_CAPACITY : 0;
+        for (uint64_t i = begin; i < written; i++) {
+            const ProfileEvent& event = ring.events[i % PROFILER_RING_CAPACITY];
+            out << ",\n{\"ph\":\"X\",\"cat\":\"" << (ring.gpu ? "gpu" : "cpu") << "\",\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"pid\":1,\"tid\":" << r << ",\"ts\":" << (double)event.start * 1e-3 << ",\"dur\":" << (double)(event.end - event.start) * 1e-3
+                << ",\"args\":{\"frame\":" << event.frame << "}}";
+        }
+    }
+    out << "\n]}\n";
+    return (bool)out;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Profiler settings
+// zones kept per thread, older ones are overwritten
+const unsigned int PROFILER_RING_CAPACITY = 1 << 16;
+// frames the summary percentiles are taken over
+const unsigned int PROFILER_SUMMARY_FRAMES = 240;
+
+// percentiles of one zone's durations, in milliseconds
+struct ProfileZoneStats {
+	std::string name;
+	bool gpu;
+	unsigned int count;
+	double mean;
+	double p50;
+	double p95;
+	double p99;
+	double max;
+};
+
+// Scoped zone profiler. Every thread records into its own ring buffer, so recording takes no lock;
+// GPU timings (see GpuProfiler) go into a ring of their own. Off by default, and a disabled zone
+// costs one flag check. Zone names must outlive the profiler (string literals).
+//
+// Reading (summaries, traces) is meant for the main thread between frames, when the job threads are
+// idle; a zone being written meanwhile may show up torn.
+class Profiler {
+	public:
+		static void setEnabled(bool enabled);
+		static bool isEnabled();
+
+		// starts the next frame, call once per frame on the main thread
+		static void beginFrame();
+		static unsigned int getFrame();
+
+		// nanoseconds since the profiler started
+		static uint64_t now();
+
+		// names the calling thread's track in traces
+		static void setThreadName(const char* name);
+
+		static void record(const char* name, uint64_t start, uint64_t end);
+		static void recordGpu(const char* name, uint64_t start, uint64_t end);
+
+		// percentiles of every zone over the last frames, CPU zones first, each group by name
+		static void getSummary(std::vector<ProfileZoneStats>& stats, unsigned int frames = PROFILER_SUMMARY_FRAMES);
+		static void writeSummary(std::ostream& out, unsigned int frames = PROFILER_SUMMARY_FRAMES);
+		// everything still in the ring buffers in the Chrome trace event format (chrome://tracing, Perfetto)
+		static bool writeChromeTrace(const std::string& path);
+};
+
+// times the enclosing scope
+class ProfileZone {
+	public:
+		explicit ProfileZone(const char* name) : name(Profiler::isEnabled() ? name : nullptr), start(this->name ? Profiler::now() : 0) {}
+		~ProfileZone() {
+			if (name) Profiler::record(name, start, Profiler::now());
+		}
+
+	private:
+		const char* name;
+		uint64_t start;
+};
+
+#define PROFILE_ZONE_CONCAT2(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT2(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_CONCAT(profileZone, __LINE__)(name)
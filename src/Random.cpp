@@ -6,6 +6,10 @@ void Random::init() {
 	srand(time(NULL));
 }
 
+void Random::init(unsigned int seed) {
+	srand(seed);
+}
+
 float Random::randFloat(){
 	return (float)((double)rand() / (double)RAND_MAX);
 }
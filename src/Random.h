@@ -3,6 +3,8 @@
 class Random {
 	public:
 		static void init();
+		// fixed seed, for reproducible runs
+		static void init(unsigned int seed);
 		static float randFloat(float range);
 		static float randFloat();
 		static int randint();
@@ -0,0 +1,518 @@
+#include "Simulation.h"
+#include "Random.h"
+#include <algorithm>
+#include <cmath>
+
+Simulation::Simulation() : useHeightfield(USE_WAVES_HEIGHTFIELD), playerSteer(0.0f), dt(0.0f), currentCamera(&boatCamera), boatCameraDistance(DEFAULT_CAM_DISTANCE), boatCameraHeight(0.0f)
+{
+    setJobThreads(JOB_THREADS_AUTO);
+}
+
+void Simulation::setJobThreads(unsigned int workerCount) {
+    if (workerCount == JOB_THREADS_AUTO) workerCount = JobSystem::getDefaultWorkerCount();
+    jobs.start(workerCount);
+    sampleBuffers.resize(jobs.getSlotCount());
+}
+
+unsigned int Simulation::getJobThreads() const {
+    return jobs.getWorkerCount();
+}
+
+void Simulation::init(unsigned int otherBoatsCount) {
+    waves.init();
+    heightfield.invalidate();
+
+    player = Boat();
+    playerSteer = glm::vec3(0.0f);
+
+    freeCamera.Position = glm::vec3(0.0f, 0.0f, 0.0f);
+    boatCamera.Position = player.position;
+    boatCamera.LerpSpeed = CAM_LERP_SPEED;
+    boatCamera.UseLerp = true;
+    boatCameraDistance = DEFAULT_CAM_DISTANCE;
+    boatCameraHeight = 0.0f;
+
+    currentCamera = &boatCamera;
+
+    updateBoatCamera();
+
+    otherBoats.clear();
+    initOtherBoats(otherBoatsCount);
+    buildOtherBoatHash();
+}
+
+void Simulation::initOtherBoats(unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        float x = Random::randFloat(MAX_OTHER_BOAT_START_DISTANCE_FROM_PLAYER) + player.position.x;
+        float z = Random::randFloat(MAX_OTHER_BOAT_START_DISTANCE_FROM_PLAYER) + player.position.z;
+        glm::vec3 spawnPos = glm::vec3(x, 0.0f, z);
+        glm::vec3 playerPos = player.position;
+        playerPos.y = 0.0f;
+        float distance = glm::length(playerPos - spawnPos);
+        while (distance < MIN_OTHER_BOAT_START_DISTANCE_FROM_PLAYER) {
+            x = Random::randFloat(MAX_OTHER_BOAT_START_DISTANCE_FROM_PLAYER) + player.position.x;
+            z = Random::randFloat(MAX_OTHER_BOAT_START_DISTANCE_FROM_PLAYER) + player.position.z;
+            spawnPos = glm::vec3(x, 0.0f, z);
+            distance = glm::length(playerPos - spawnPos);
+        }
+
+        Boat boat;
+        boat.position = spawnPos;
+        boat.currentBearing = playerPos - spawnPos;
+        boat.currentBearing.y = 0.0f;
+        glm::vec3 forwardYaw = glm::normalize(boat.currentBearing);
+        boat.right = glm::normalize(glm::cross(forwardYaw, glm::vec3(0.0f, 1.0f, 0.0f)));
+        boat.forward = glm::normalize(glm::cross(boat.up, boat.right));
+
+        if (i < MAX_OTHER_BOATS_FOLLOW_COUNT) boat.followPlayer = true;
+        else {
+            glm::vec3 destDir = glm::vec3(
+                Random::randFloat(1.0f),
+                0.0f,
+                Random::randFloat(1.0f)
+            );
+            boat.destDir = destDir;
+        }
+
+        otherBoats.add(boat);
+    }
+}
+
+// turns a (normalized) forward vector towards a (normalized, flat) direction at BOAT_TURN_RATE,
+// going round the nearer side when the direction is behind
+static glm::vec3 turnTowards(glm::vec3 currentForward, glm::vec3 direction, float dt) {
+    float dirDot = glm::dot(direction, currentForward);
+    if (dirDot < 0.0f) {
+        glm::vec3 currentRight = glm::normalize(glm::cross(currentForward, glm::vec3(0.0f, 1.0f, 0.0f)));
+        float angleFromRight = acos(glm::dot(currentRight, direction));
+        float angleFromLeft = acos(glm::dot(-currentRight, direction));
+
+        direction = glm::normalize((abs(angleFromRight) < abs(angleFromLeft) ? currentRight : -currentRight));
+    }
+    glm::vec3 v = direction - currentForward;
+    float difference = glm::length(v);
+    glm::vec3 normalized = difference < 0.0001f ? direction : glm::normalize(v);
+    currentForward += normalized * glm::clamp(difference, 0.0f, BOAT_TURN_RATE * dt);
+    return glm::normalize(currentForward);
+}
+
+void Simulation::steerPlayer(glm::vec3 direction) {
+    playerSteer = direction;
+}
+
+void Simulation::turnPlayer(glm::vec3 direction) {
+    direction.y = 0.0f;
+    glm::vec3 currentForward = player.currentBearing;
+    currentForward.y = 0.0f;
+    player.currentBearing = turnTowards(glm::normalize(currentForward), glm::normalize(direction), dt);
+    player.speed = BOAT_SPEED;
+}
+
+void Simulation::moveOtherBoat(unsigned int i, glm::vec3 direction) {
+    // AI boats turn from where the hull points, not from their flattened bearing
+    otherBoats.turnBoat(i, direction.x, direction.z, BOAT_TURN_RATE * dt);
+    otherBoats.speed[i] = BOAT_SPEED;
+}
+
+void Simulation::sampleBuoyancy() {
+    PROFILE_ZONE("buoyancy");
+    enum FloatGroup { NEAR_GROUP, FAR_GROUP, HEIGHTFIELD_GROUP };
+
+    unsigned int count = (unsigned int)otherBoats.size() + 1;
+    floatSlots.resize(count);
+    floatPositions.resize(count);
+    floatTargets.resize(count);
+    floatNormals.resize(count);
+
+    // sort every boat into a group first, then hand out the slots group by group
+    jobs.parallelFor(count, FLEET_JOB_GRAIN, [this](unsigned int begin, unsigned int end, unsigned int) {
+        for (unsigned int i = begin; i < end; i++) {
+            glm::vec3 position = i == 0 ? player.position : otherBoats.getPosition(i - 1);
+            unsigned int group = FAR_GROUP;
+            if (useHeightfield && heightfield.sampleAverage(position, floatTargets[i], floatNormals[i])) group = HEIGHTFIELD_GROUP;
+            else if (i == 0 || glm::length(position - player.position) <= BOAT_FULL_WAVES_QUALITY_DISTANCE) group = NEAR_GROUP;
+            floatSlots[i] = group;
+        }
+    });
+
+    unsigned int groupCounts[3] = { 0, 0, 0 };
+    for (unsigned int i = 0; i < count; i++) {
+        groupCounts[floatSlots[i]]++;
+    }
+
+    // backwards, so a heightfield result (stored at index i above) only moves to a slot at or after i
+    // whose own result was already moved out
+    unsigned int slotEnd[3] = { groupCounts[NEAR_GROUP], groupCounts[NEAR_GROUP] + groupCounts[FAR_GROUP], count };
+    for (unsigned int i = count; i-- > 0;) {
+        unsigned int slot = --slotEnd[floatSlots[i]];
+        if (floatSlots[i] == HEIGHTFIELD_GROUP) {
+            floatTargets[slot] = floatTargets[i];
+            floatNormals[slot] = floatNormals[i];
+        }
+        floatPositions[slot] = i == 0 ? player.position : otherBoats.getPosition(i - 1);
+        floatSlots[i] = slot;
+    }
+
+    unsigned int nearCount = groupCounts[NEAR_GROUP];
+    unsigned int farCount = groupCounts[FAR_GROUP];
+    jobs.parallelFor(nearCount, BUOYANCY_JOB_GRAIN, [this](unsigned int begin, unsigned int end, unsigned int slot) {
+        PROFILE_ZONE("buoyancy job");
+        waves.sampleAverageBatch(floatPositions.data() + begin, (int)(end - begin), sampleBuffers[slot],
+            floatTargets.data() + begin, floatNormals.data() + begin);
+    });
+    jobs.parallelFor(farCount, BUOYANCY_JOB_GRAIN, [this, nearCount](unsigned int begin, unsigned int end, unsigned int slot) {
+        PROFILE_ZONE("buoyancy far job");
+        waves.sampleAverageBatch(floatPositions.data() + nearCount + begin, (int)(end - begin), sampleBuffers[slot],
+            floatTargets.data() + nearCount + begin, floatNormals.data() + nearCount + begin, FAR_BOAT_WAVES_QUALITY);
+    });
+}
+
+// moves a boat towards its sampled target/normal and integrates its speed along its bearing
+static void floatBoat(glm::vec3& position, glm::vec3& forward, glm::vec3& right, glm::vec3& up, glm::vec3 bearing, float& speed,
+    glm::vec3 target, glm::vec3 surfaceNormal, float dt) {
+    glm::vec3 current = position;
+    glm::vec3 moveVec = target - current;
+    float distance = glm::length(moveVec);
+    glm::vec3 moveDir = distance > 0.0001f ? glm::normalize(moveVec) : glm::vec3(0.0f);
+    float moveAmount = glm::clamp(distance, 0.0f, BOAT_HEIGHT_LERP_SPEED * dt);
+    position += moveDir * moveAmount;
+
+    glm::vec3 upMove = surfaceNormal - up;
+    float difference = glm::length(upMove);
+    // the heightfield hands out the exact same normal until the next bake
+    if (difference > 0.0001f) up += glm::normalize(upMove) * glm::clamp(difference, 0.0f, BOAT_ROTATION_SPEED * dt);
+
+    glm::vec3 forwardYaw = glm::normalize(bearing);
+    right = glm::normalize(glm::cross(forwardYaw, up));
+    forward = glm::normalize(glm::cross(up, right));
+
+    if (speed > 0.0f) {
+        position += glm::normalize(bearing) * speed * dt;
+        speed -= BOAT_DRAG * dt;
+    }
+}
+
+void Simulation::updateBoat(Boat& boat, glm::vec3 target, glm::vec3 surfaceNormal) {
+    floatBoat(boat.position, boat.forward, boat.right, boat.up, boat.currentBearing, boat.speed, target, surfaceNormal, dt);
+}
+
+void Simulation::updateOtherBoats() {
+    PROFILE_ZONE("updateOtherBoats");
+    floatOtherBoats();
+    // steering below only turns the boats, so the positions hashed here hold for the whole pass
+    buildOtherBoatHash();
+    steerOtherBoats();
+}
+
+void Simulation::floatOtherBoats() {
+    PROFILE_ZONE("float boats");
+    jobs.parallelFor(otherBoats.size(), FLEET_JOB_GRAIN, [this](unsigned int begin, unsigned int end, unsigned int) {
+        PROFILE_ZONE("float boats job");
+        // floatBoat() on the fleet arrays
+        float* positionX = otherBoats.positionX.data();
+        float* positionY = otherBoats.positionY.data();
+        float* positionZ = otherBoats.positionZ.data();
+        float* forwardX = otherBoats.forwardX.data();
+        float* forwardY = otherBoats.forwardY.data();
+        float* forwardZ = otherBoats.forwardZ.data();
+        float* rightX = otherBoats.rightX.data();
+        float* rightY = otherBoats.rightY.data();
+        float* rightZ = otherBoats.rightZ.data();
+        float* upX = otherBoats.upX.data();
+        float* upY = otherBoats.upY.data();
+        float* upZ = otherBoats.upZ.data();
+        const float* bearingX = otherBoats.bearingX.data();
+        const float* bearingY = otherBoats.bearingY.data();
+        const float* bearingZ = otherBoats.bearingZ.data();
+        float* speed = otherBoats.speed.data();
+        const unsigned int* slots = floatSlots.data() + 1;
+        const glm::vec3* targets = floatTargets.data();
+        const glm::vec3* normals = floatNormals.data();
+        const float maxMove = BOAT_HEIGHT_LERP_SPEED * dt;
+        const float maxTilt = BOAT_ROTATION_SPEED * dt;
+
+        for (unsigned int i = begin; i < end; i++) {
+            const glm::vec3& target = targets[slots[i]];
+            const glm::vec3& normal = normals[slots[i]];
+
+            float moveX = target.x - positionX[i];
+            float moveY = target.y - positionY[i];
+            float moveZ = target.z - positionZ[i];
+            float distance = std::sqrt(moveX * moveX + moveY * moveY + moveZ * moveZ);
+            float move = distance > 0.0001f ? std::min(distance, maxMove) / distance : 0.0f;
+            float x = positionX[i] + moveX * move;
+            float y = positionY[i] + moveY * move;
+            float z = positionZ[i] + moveZ * move;
+
+            float tiltX = normal.x - upX[i];
+            float tiltY = normal.y - upY[i];
+            float tiltZ = normal.z - upZ[i];
+            float difference = std::sqrt(tiltX * tiltX + tiltY * tiltY + tiltZ * tiltZ);
+            float tilt = difference > 0.0001f ? std::min(difference, maxTilt) / difference : 0.0f;
+            float ux = upX[i] + tiltX * tilt;
+            float uy = upY[i] + tiltY * tilt;
+            float uz = upZ[i] + tiltZ * tilt;
+
+            float yawScale = 1.0f / std::sqrt(bearingX[i] * bearingX[i] + bearingY[i] * bearingY[i] + bearingZ[i] * bearingZ[i]);
+            float yawX = bearingX[i] * yawScale;
+            float yawY = bearingY[i] * yawScale;
+            float yawZ = bearingZ[i] * yawScale;
+
+            // right = cross(yaw, up), forward = cross(up, right)
+            float rx = yawY * uz - yawZ * uy;
+            float ry = yawZ * ux - yawX * uz;
+            float rz = yawX * uy - yawY * ux;
+            float rightScale = 1.0f / std::sqrt(rx * rx + ry * ry + rz * rz);
+            rx *= rightScale;
+            ry *= rightScale;
+            rz *= rightScale;
+            float fx = uy * rz - uz * ry;
+            float fy = uz * rx - ux * rz;
+            float fz = ux * ry - uy * rx;
+            float forwardScale = 1.0f / std::sqrt(fx * fx + fy * fy + fz * fz);
+
+            float s = speed[i];
+            if (s > 0.0f) {
+                x += yawX * s * dt;
+                y += yawY * s * dt;
+                z += yawZ * s * dt;
+                s -= BOAT_DRAG * dt;
+            }
+
+            positionX[i] = x;
+            positionY[i] = y;
+            positionZ[i] = z;
+            upX[i] = ux;
+            upY[i] = uy;
+            upZ[i] = uz;
+            rightX[i] = rx;
+            rightY[i] = ry;
+            rightZ[i] = rz;
+            forwardX[i] = fx * forwardScale;
+            forwardY[i] = fy * forwardScale;
+            forwardZ[i] = fz * forwardScale;
+            speed[i] = s;
+        }
+
+        for (unsigned int i = begin; i < end; i++) {
+            if (!otherBoats.isFlipped[i]) continue;
+            if (otherBoats.t_flip[i] < 1.0f) otherBoats.t_flip[i] += BOAT_FLIP_SPEED * dt;
+            else if (otherBoats.t_flip[i] > 1.0f) otherBoats.t_flip[i] = 1.0f;
+        }
+    });
+}
+
+void Simulation::steerOtherBoats() {
+    // reads every boat's position, but only turns boat i
+    PROFILE_ZONE("steer boats");
+    jobs.parallelFor(otherBoats.size(), FLEET_JOB_GRAIN, [this](unsigned int begin, unsigned int end, unsigned int) {
+        PROFILE_ZONE("steer boats job");
+        for (unsigned int i = begin; i < end; i++) {
+            steerOtherBoat(i);
+        }
+    });
+}
+
+void Simulation::steerOtherBoat(unsigned int i) {
+    if (otherBoats.isFlipped[i]) return;
+
+    glm::vec3 position = otherBoats.getPosition(i);
+    glm::vec3 toPlayer = player.position - position;
+    float distanceFromPlayer = glm::length(toPlayer);
+
+    //float playerDot = glm::dot(glm::normalize(toPlayer), glm::normalize(otherBoats.getForward(i)));
+    //if (distanceFromPlayer < BOAT_COLLISION_DISTANCE && abs(playerDot) < 0.1f) {
+    //    otherBoats.isFlipped[i] = 1;
+    //    return;
+    //}
+
+    // steer away from the lowest indexed boat that is too close
+    bool canMoveTowardPlayer = true;
+    int closeBoat = otherBoatHash.findFirst(position, MIN_DISTANCE_BETWEEN_OTHER_BOATS, i);
+    if (closeBoat >= 0) {
+        glm::vec3 toOther = otherBoats.getPosition(closeBoat) - position;
+        moveOtherBoat(i, -toOther);
+        canMoveTowardPlayer = false;
+    }
+
+    if (!otherBoats.followPlayer[i]) {
+        if (distanceFromPlayer > MAX_OTHER_BOAT_DISTANCE_TO_CHANGE_DIRECTION) {
+            glm::vec3 destDir = toPlayer;
+            destDir.y = 0.0f;
+            otherBoats.setDestDir(i, destDir);
+        }
+        else if (distanceFromPlayer < MIN_DISTANCE_FROM_PLAYER) {
+            moveOtherBoat(i, -toPlayer);
+            return;
+        }
+
+        moveOtherBoat(i, otherBoats.getDestDir(i));
+        return;
+    }
+
+    if (canMoveTowardPlayer && distanceFromPlayer > MIN_DISTANCE_FROM_PLAYER) moveOtherBoat(i, toPlayer);
+}
+
+void Simulation::buildOtherBoatHash() {
+    PROFILE_ZONE("boat hash");
+    otherBoatHash.build(otherBoats.positionX.data(), otherBoats.positionY.data(), otherBoats.positionZ.data(), otherBoats.size(), MIN_DISTANCE_BETWEEN_OTHER_BOATS);
+}
+
+void Simulation::findOtherBoatsNear(glm::vec3 position, float radius, std::vector<unsigned int>& results) const {
+    otherBoatHash.query(position, radius, results);
+}
+
+void Simulation::update(float dt) {
+    PROFILE_ZONE("simulation update");
+    this->dt = dt;
+    if (glm::length(playerSteer) > 0.0f) turnPlayer(playerSteer);
+    waves.advance(dt);
+
+    if (currentCamera == &boatCamera) {
+        boatCamera.UpdateLerp(dt);
+        updateBoatCamera();
+    }
+
+    if (useHeightfield) {
+        PROFILE_ZONE("heightfield");
+        heightfield.update(waves, player.position, dt);
+    }
+
+    glm::vec3 temp;
+    glm::vec3 camPosAtWaves;
+    if (!useHeightfield || !heightfield.sample(currentCamera->getPosition(), camPosAtWaves, temp)) {
+        camPosAtWaves = waves.sample(currentCamera->getPosition(), temp);
+    }
+    if (currentCamera->Position.y < camPosAtWaves.y) currentCamera->Position.y = camPosAtWaves.y;
+
+    sampleBuoyancy();
+    updateBoat(player, floatTargets[floatSlots[0]], floatNormals[floatSlots[0]]);
+
+    updateOtherBoats();
+}
+
+void Simulation::updateBoatCamera() {
+    glm::vec3 pos = player.position - boatCamera.Forward * boatCameraDistance;
+    pos.y += boatCameraHeight;
+    boatCamera.Position = pos;
+}
+
+void Simulation::moveFreeCamera(glm::vec3 movement, float dt) {
+    freeCamera.ProcessKeyboard(movement, dt);
+}
+
+void Simulation::rotateCameras(float xoffset, float yoffset, GLboolean constrainPitch) {
+    freeCamera.ProcessMouseMovement(xoffset, yoffset, constrainPitch);
+    boatCamera.ProcessMouseMovement(xoffset, yoffset, constrainPitch);
+}
+
+void Simulation::adjustBoatCameraHeight(float yoffset) {
+    boatCameraHeight += yoffset * dt;
+}
+
+void Simulation::zoomBoatCamera(float yoffset) {
+    boatCameraDistance -= yoffset;
+    boatCameraDistance = glm::clamp(boatCameraDistance, MIN_CAM_DISTANCE, MAX_CAM_DISTANCE);
+}
+
+void Simulation::switchCamera() {
+    Camera* lastCamera = currentCamera;
+    currentCamera = currentCamera == &freeCamera ? &boatCamera : &freeCamera;
+    currentCamera->SetForwardVector(lastCamera->Forward);
+
+    if (currentCamera == &freeCamera) currentCamera->Position = lastCamera->Position;
+}
+
+bool Simulation::isBoatCameraActive() const {
+    return currentCamera == &boatCamera;
+}
+
+Camera& Simulation::getCurrentCamera() {
+    return *currentCamera;
+}
+
+void Simulation::setWavesHeightfieldEnabled(bool enabled) {
+    useHeightfield = enabled;
+    // a grid kept while disabled would be stale
+    heightfield.invalidate();
+}
+
+bool Simulation::isWavesHeightfieldEnabled() const {
+    return useHeightfield;
+}
+
+const WaveField& Simulation::getWaves() const {
+    return waves;
+}
+
+const Boat& Simulation::getPlayer() const {
+    return player;
+}
+
+const Fleet& Simulation::getOtherBoats() const {
+    return otherBoats;
+}
+
+static void copyTransform(const Boat& boat, BoatTransform& transform) {
+    transform.position = boat.position;
+    transform.forward = boat.forward;
+    transform.right = boat.right;
+    transform.up = boat.up;
+    transform.isFlipped = boat.isFlipped;
+    transform.t_flip = boat.t_flip;
+}
+
+void Simulation::writeSnapshot(SimulationSnapshot& snapshot) {
+    snapshot.wavesTime = waves.getTime();
+    copyTransform(player, snapshot.player);
+
+    snapshot.otherBoats.resize(otherBoats.size());
+    for (unsigned int i = 0; i < otherBoats.size(); i++) {
+        BoatTransform& transform = snapshot.otherBoats[i];
+        transform.position = otherBoats.getPosition(i);
+        transform.forward = otherBoats.getForward(i);
+        transform.right = otherBoats.getRight(i);
+        transform.up = otherBoats.getUp(i);
+        transform.isFlipped = otherBoats.isFlipped[i] != 0;
+        transform.t_flip = otherBoats.t_flip[i];
+    }
+
+    snapshot.viewPos = currentCamera->getPosition();
+    snapshot.viewForward = currentCamera->getForward();
+    snapshot.viewUp = currentCamera->getUp();
+    snapshot.view = currentCamera->GetViewMatrix();
+}
+
+static glm::vec3 interpolateDirection(glm::vec3 from, glm::vec3 to, float alpha) {
+    glm::vec3 v = glm::mix(from, to, alpha);
+    float length = glm::length(v);
+    // opposite directions mix to nothing, keep the newer one then
+    return length > 0.0001f ? v / length : to;
+}
+
+static void interpolateTransform(const BoatTransform& from, const BoatTransform& to, float alpha, BoatTransform& result) {
+    result.position = glm::mix(from.position, to.position, alpha);
+    result.forward = interpolateDirection(from.forward, to.forward, alpha);
+    result.right = interpolateDirection(from.right, to.right, alpha);
+    result.up = interpolateDirection(from.up, to.up, alpha);
+    result.isFlipped = to.isFlipped;
+    result.t_flip = to.isFlipped == from.isFlipped ? glm::mix(from.t_flip, to.t_flip, alpha) : to.t_flip;
+}
+
+void interpolateSnapshots(const SimulationSnapshot& from, const SimulationSnapshot& to, float alpha, SimulationSnapshot& result) {
+    alpha = glm::clamp(alpha, 0.0f, 1.0f);
+    result.wavesTime = glm::mix(from.wavesTime, to.wavesTime, alpha);
+    interpolateTransform(from.player, to.player, alpha, result.player);
+
+    result.otherBoats.resize(to.otherBoats.size());
+    bool sameFleet = from.otherBoats.size() == to.otherBoats.size();
+    for (unsigned int i = 0; i < to.otherBoats.size(); i++) {
+        if (sameFleet) interpolateTransform(from.otherBoats[i], to.otherBoats[i], alpha, result.otherBoats[i]);
+        else result.otherBoats[i] = to.otherBoats[i];
+    }
+
+    result.viewPos = glm::mix(from.viewPos, to.viewPos, alpha);
+    result.viewForward = interpolateDirection(from.viewForward, to.viewForward, alpha);
+    result.viewUp = interpolateDirection(from.viewUp, to.viewUp, alpha);
+    result.view = glm::lookAt(result.viewPos, result.viewPos + result.viewForward, result.viewUp);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Camera.h"
+#include "WaveField.h"
+#include "WaveHeightfield.h"
+#include "SpatialHash.h"
+#include "Fleet.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <vector>
+
+// Boat settings
+const float BOAT_HEIGHT_LERP_SPEED = 5.0f;
+const float BOAT_ROTATION_SPEED = 0.125f;
+const unsigned int MAX_OTHER_BOATS_COUNT = 6;
+const unsigned int MAX_OTHER_BOATS_FOLLOW_COUNT = 1;
+const float MIN_OTHER_BOAT_START_DISTANCE_FROM_PLAYER = 50.0f;
+const float MAX_OTHER_BOAT_START_DISTANCE_FROM_PLAYER = 400.0f;
+const float MAX_OTHER_BOAT_DISTANCE_TO_CHANGE_DIRECTION = 600.0f;
+const float MIN_DISTANCE_BETWEEN_OTHER_BOATS = 45.0f;
+const float MIN_DISTANCE_FROM_PLAYER = 50.0f;
+const float OTHER_BOAT_SPEED = 8.0f;
+const float BOAT_COLLISION_DISTANCE = 28.0f;
+const float BOAT_FLIP_SPEED = 1.0f;
+const float BOAT_TURN_RATE = 0.5f;
+const float BOAT_SPEED = 12.0f;
+const float BOAT_DRAG = 5.0f;
+// AI boats further than this from the player float on a cheaper wave preset
+const float BOAT_FULL_WAVES_QUALITY_DISTANCE = 150.0f;
+const WaveQuality FAR_BOAT_WAVES_QUALITY = WAVES_QUALITY_MEDIUM_WARPED;
+// buoyancy and camera queries read a heightfield baked around the player instead of evaluating the waves
+const bool USE_WAVES_HEIGHTFIELD = false;
+// boats per job in the parallel fleet passes; wave sampling costs far more per boat than the rest
+const unsigned int FLEET_JOB_GRAIN = 256;
+const unsigned int BUOYANCY_JOB_GRAIN = 16;
+
+// Boat camera settings
+const float CAM_LERP_SPEED = 10.0f;
+const float MAX_CAM_DISTANCE = 125.0f;
+const float MIN_CAM_DISTANCE = 20.0f;
+const float DEFAULT_CAM_DISTANCE = (MAX_CAM_DISTANCE - MIN_CAM_DISTANCE) * 0.5f + MIN_CAM_DISTANCE;
+
+// the part of a boat the renderer needs to draw it
+struct BoatTransform {
+	BoatTransform(): position(0.0f), forward(0.0f, 0.0f, 1.0f), right(1.0f, 0.0f, 0.0f), up(0.0f, 1.0f, 0.0f), isFlipped(false), t_flip(0.0f) {}
+	glm::vec3 position;
+	glm::vec3 forward;
+	glm::vec3 right;
+	glm::vec3 up;
+	bool isFlipped;
+	float t_flip;
+};
+
+// everything the renderer reads from the simulation for one frame
+struct SimulationSnapshot {
+	float wavesTime;
+	BoatTransform player;
+	std::vector<BoatTransform> otherBoats;
+	glm::vec3 viewPos;
+	glm::vec3 viewForward;
+	glm::vec3 viewUp;
+	glm::mat4 view;
+};
+
+// blends two consecutive snapshots for drawing between simulation steps, alpha 0 = from, 1 = to.
+// Directions are lerped and renormalized, flags and boat counts come from to
+void interpolateSnapshots(const SimulationSnapshot& from, const SimulationSnapshot& to, float alpha, SimulationSnapshot& result);
+
+// The ocean, the player boat, the AI boats and the cameras following them.
+// Owns no GL objects, so it can be stepped without a window (see headless_main.cpp).
+class Simulation {
+	public:
+		Simulation();
+
+		// rolls new waves and spawns otherBoatsCount AI boats around the player
+		void init(unsigned int otherBoatsCount = MAX_OTHER_BOATS_COUNT);
+		void update(float dt);
+
+		// steers the player towards direction on every update until called again, a zero vector lets go
+		void steerPlayer(glm::vec3 direction);
+
+		void moveFreeCamera(glm::vec3 movement, float dt);
+		void rotateCameras(float xoffset, float yoffset, GLboolean constrainPitch = true);
+		void adjustBoatCameraHeight(float yoffset);
+		void zoomBoatCamera(float yoffset);
+		void switchCamera();
+		bool isBoatCameraActive() const;
+		Camera& getCurrentCamera();
+
+		// threads besides the caller for the fleet passes, JOB_THREADS_AUTO for one per spare hardware thread
+		void setJobThreads(unsigned int workerCount);
+		unsigned int getJobThreads() const;
+
+		void setWavesHeightfieldEnabled(bool enabled);
+		bool isWavesHeightfieldEnabled() const;
+
+		const WaveField& getWaves() const;
+		const Boat& getPlayer() const;
+		const Fleet& getOtherBoats() const;
+		// indices into getOtherBoats() of the AI boats within radius of position, as of the last update
+		void findOtherBoatsNear(glm::vec3 position, float radius, std::vector<unsigned int>& results) const;
+
+		// copies the drawable state into snapshot, reusing its storage
+		void writeSnapshot(SimulationSnapshot& snapshot);
+
+	private:
+		WaveField waves;
+		WaveHeightfield heightfield;
+		bool useHeightfield;
+
+		Boat player;
+		glm::vec3 playerSteer;
+		void turnPlayer(glm::vec3 direction);
+		Fleet otherBoats;
+
+		float dt;
+
+		// the fleet passes run as parallel-for jobs with a barrier after each, and every job only
+		// writes the boats of its own range, so results don't depend on the thread count
+		JobSystem jobs;
+
+		Camera freeCamera;
+		Camera boatCamera;
+		Camera* currentCamera;
+		float boatCameraDistance;
+		float boatCameraHeight;
+		void updateBoatCamera();
+
+		void initOtherBoats(unsigned int count);
+		void updateOtherBoats();
+
+		// the fleet passes of updateOtherBoats(), in order
+		void floatOtherBoats();
+		void steerOtherBoats();
+		void steerOtherBoat(unsigned int i);
+
+		// AI boat positions bucketed by MIN_DISTANCE_BETWEEN_OTHER_BOATS cells, rebuilt every update
+		SpatialHash otherBoatHash;
+		void buildOtherBoatHash();
+
+		// buoyancy samples for the player and every AI boat, one batch per wave preset per update.
+		// floatSlots[0] is the player's slot, floatSlots[i + 1] the slot of otherBoats[i]; near boats
+		// take the front slots, far boats the ones after them and boats read from the heightfield the
+		// back ones, so each group is contiguous
+		// one sample buffer per job slot
+		std::vector<WaveSampleBuffer> sampleBuffers;
+		std::vector<unsigned int> floatSlots;
+		std::vector<glm::vec3> floatPositions;
+		std::vector<glm::vec3> floatTargets;
+		std::vector<glm::vec3> floatNormals;
+		void sampleBuoyancy();
+
+		// floats the boat towards its sampled target/normal and integrates its speed
+		void updateBoat(Boat& boat, glm::vec3 target, glm::vec3 surfaceNormal);
+
+		// turns AI boat i towards direction at full speed
+		void moveOtherBoat(unsigned int i, glm::vec3 direction);
+};
@@ -0,0 +1,52 @@
+#include "SimulationClock.h"
+#include <cmath>
+
+SimulationClock::SimulationClock() : step(1.0f / SIMULATION_DEFAULT_RATE), maxStepsPerFrame(SIMULATION_MAX_STEPS_PER_FRAME), accumulator(0.0), droppedTime(0.0)
+{
+}
+
+void SimulationClock::configure(float rate, unsigned int maxStepsPerFrame) {
+    step = 1.0f / (rate > 0.0f ? rate : SIMULATION_DEFAULT_RATE);
+    this->maxStepsPerFrame = maxStepsPerFrame > 0 ? maxStepsPerFrame : 1;
+    reset();
+}
+
+void SimulationClock::reset() {
+    accumulator = 0.0;
+    droppedTime = 0.0;
+}
+
+unsigned int SimulationClock::advance(float frameTime) {
+    if (frameTime > 0.0f) accumulator += frameTime;
+
+    unsigned int steps = 0;
+    while (accumulator >= step && steps < maxStepsPerFrame) {
+        accumulator -= step;
+        steps++;
+    }
+
+    // still a step or more behind: the simulation can't keep up, so let it fall behind wall time
+    // instead of making every following frame longer
+    if (accumulator >= step) {
+        double kept = fmod(accumulator, (double)step);
+        droppedTime += accumulator - kept;
+        accumulator = kept;
+    }
+    return steps;
+}
+
+float SimulationClock::getRate() const {
+    return 1.0f / step;
+}
+
+float SimulationClock::getStep() const {
+    return step;
+}
+
+float SimulationClock::getAlpha() const {
+    return (float)(accumulator / step);
+}
+
+double SimulationClock::getDroppedTime() const {
+    return droppedTime;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Fixed step settings
+const float SIMULATION_DEFAULT_RATE = 60.0f;
+// steps one frame may run to catch up; beyond that the backlog is dropped instead of growing every frame
+const unsigned int SIMULATION_MAX_STEPS_PER_FRAME = 5;
+
+// Turns variable frame times into a whole number of fixed simulation steps. Leftover time carries to
+// the next frame, and getAlpha() tells how far the frame is between the last two steps, for
+// interpolating what gets drawn.
+class SimulationClock {
+	public:
+		SimulationClock();
+
+		void configure(float rate, unsigned int maxStepsPerFrame = SIMULATION_MAX_STEPS_PER_FRAME);
+		void reset();
+
+		// adds frameTime to the accumulator and returns the steps to run this frame
+		unsigned int advance(float frameTime);
+
+		float getRate() const;
+		float getStep() const;
+		// 0 = the frame shows the last step, 1 = one full step past it
+		float getAlpha() const;
+		// seconds thrown away by the step cap since the last reset
+		double getDroppedTime() const;
+
+	private:
+		float step;
+		unsigned int maxStepsPerFrame;
+		double accumulator;
+		double droppedTime;
+};
@@ -0,0 +1,91 @@
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+
+SpatialHash::SpatialHash() : cellSize(1.0f), tableMask(0), xs(nullptr), ys(nullptr), zs(nullptr) {
+}
+
+int SpatialHash::cellCoord(float v) const {
+    return (int)floor(v / cellSize);
+}
+
+float SpatialHash::distanceTo(unsigned int i, glm::vec3 center) const {
+    return glm::length(glm::vec3(xs[i], ys[i], zs[i]) - center);
+}
+
+unsigned int SpatialHash::bucketOf(int cellX, int cellZ) const {
+    unsigned int h = (unsigned int)cellX * 73856093u ^ (unsigned int)cellZ * 19349663u;
+    return h & tableMask;
+}
+
+void SpatialHash::build(const float* xs, const float* ys, const float* zs, unsigned int count, float cellSize) {
+    this->xs = xs;
+    this->ys = ys;
+    this->zs = zs;
+    this->cellSize = cellSize;
+
+    // power of two with at least two buckets per point keeps the buckets short
+    unsigned int tableSize = 1;
+    while (tableSize < count * 2) tableSize <<= 1;
+    tableMask = tableSize - 1;
+
+    bucketStart.assign(tableSize + 1, 0);
+    pointBuckets.resize(count);
+    entries.resize(count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        pointBuckets[i] = bucketOf(cellCoord(xs[i]), cellCoord(zs[i]));
+        bucketStart[pointBuckets[i] + 1]++;
+    }
+    for (unsigned int b = 0; b < tableSize; b++) {
+        bucketStart[b + 1] += bucketStart[b];
+    }
+
+    // filled in index order, so every bucket lists its points in ascending order
+    bucketFill.assign(bucketStart.begin(), bucketStart.end() - 1);
+    for (unsigned int i = 0; i < count; i++) {
+        entries[bucketFill[pointBuckets[i]]++] = i;
+    }
+}
+
+void SpatialHash::query(glm::vec3 center, float radius, std::vector<unsigned int>& results) const {
+    results.clear();
+    if (xs == nullptr) return;
+
+    int minX = cellCoord(center.x - radius), maxX = cellCoord(center.x + radius);
+    int minZ = cellCoord(center.z - radius), maxZ = cellCoord(center.z + radius);
+    for (int x = minX; x <= maxX; x++) {
+        for (int z = minZ; z <= maxZ; z++) {
+            unsigned int b = bucketOf(x, z);
+            for (unsigned int e = bucketStart[b]; e < bucketStart[b + 1]; e++) {
+                unsigned int i = entries[e];
+                if (distanceTo(i, center) < radius) results.push_back(i);
+            }
+        }
+    }
+
+    // cells can share a bucket, so the same point may have been visited more than once
+    std::sort(results.begin(), results.end());
+    results.erase(std::unique(results.begin(), results.end()), results.end());
+}
+
+int SpatialHash::findFirst(glm::vec3 center, float radius, unsigned int exclude) const {
+    if (xs == nullptr) return -1;
+
+    int first = -1;
+    int minX = cellCoord(center.x - radius), maxX = cellCoord(center.x + radius);
+    int minZ = cellCoord(center.z - radius), maxZ = cellCoord(center.z + radius);
+    for (int x = minX; x <= maxX; x++) {
+        for (int z = minZ; z <= maxZ; z++) {
+            unsigned int b = bucketOf(x, z);
+            for (unsigned int e = bucketStart[b]; e < bucketStart[b + 1]; e++) {
+                unsigned int i = entries[e];
+                // buckets are sorted, nothing after this can be lower
+                if (first >= 0 && i >= (unsigned int)first) break;
+                if (i == exclude) continue;
+                if (distanceTo(i, center) < radius) first = (int)i;
+            }
+        }
+    }
+    return first;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Uniform grid over the x/z plane for neighbour queries between boats, rebuilt from scratch every
+// update in O(n). Cells are hashed into a table sized to the point count, so the grid is unbounded;
+// points of different cells can share a bucket, which queries filter out by distance.
+class SpatialHash {
+	public:
+		SpatialHash();
+
+		// cellSize should be about the largest query radius, so a query only visits a 3x3 block of cells
+		// the arrays are read again by the queries, so they have to stay untouched until the next build
+		void build(const float* xs, const float* ys, const float* zs, unsigned int count, float cellSize);
+
+		// indices of the points within radius of center (3D distance), in ascending order
+		void query(glm::vec3 center, float radius, std::vector<unsigned int>& results) const;
+		// lowest index within radius of center, skipping exclude; -1 if there is none
+		int findFirst(glm::vec3 center, float radius, unsigned int exclude) const;
+
+	private:
+		float cellSize;
+		unsigned int tableMask;
+		const float* xs;
+		const float* ys;
+		const float* zs;
+
+		// counting sort of the point indices by bucket: bucket b holds entries[bucketStart[b] .. bucketStart[b + 1])
+		std::vector<unsigned int> bucketStart;
+		std::vector<unsigned int> entries;
+		std::vector<unsigned int> pointBuckets;
+		std::vector<unsigned int> bucketFill;
+
+		int cellCoord(float v) const;
+		float distanceTo(unsigned int i, glm::vec3 center) const;
+		unsigned int bucketOf(int cellX, int cellZ) const;
+};
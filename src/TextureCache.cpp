@@ -0,0 +1,234 @@
+#include "TextureCache.h"
+#include <stb_image.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+extern "C" {
+#include <image_DXT.h>
+#include <image_helper.h>
+}
+
+namespace {
+
+const char CACHE_MAGIC[4] = { 'W', 'T', 'C', 'H' };
+
+enum CacheOptionFlags {
+    CACHE_FLIP_VERTICALLY = 1,
+    CACHE_MIPMAPS = 2,
+    CACHE_COMPRESS = 4
+};
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    // the options the cache was built with
+    uint32_t requestedChannels;
+    uint32_t optionFlags;
+    uint32_t channels;
+    uint32_t compressedFormat;
+    uint32_t levelCount;
+    uint32_t padding;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+};
+
+// one per level after the header, then the level data back to back
+struct CacheLevel {
+    uint32_t width;
+    uint32_t height;
+    uint32_t size;
+};
+
+uint32_t getOptionFlags(const TextureCacheOptions& options) {
+    return (options.flipVertically ? CACHE_FLIP_VERTICALLY : 0) | (options.mipmaps ? CACHE_MIPMAPS : 0) | (options.compress ? CACHE_COMPRESS : 0);
+}
+
+size_t getLevelSize(int width, int height, int channels, GLenum compressedFormat) {
+    size_t blocks = (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4);
+    switch (compressedFormat) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return blocks * 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return blocks * 16;
+        default: return (size_t)width * height * channels;
+    }
+}
+
+}
+
+size_t TextureData::getSize() const {
+    size_t size = 0;
+    for (unsigned int i = 0; i < levels.size(); i++) {
+        size += levels[i].size;
+    }
+    return size;
+}
+
+bool TextureCache::load(const std::string& sourcePath, const TextureCacheOptions& options, TextureData& texture) {
+    MappedFile source;
+    if (!source.open(sourcePath)) return false;
+    uint64_t sourceSize = source.size();
+    uint64_t sourceHash = hashBytes(source.data(), source.size());
+
+    std::string cachePath = sourcePath + TEXTURE_CACHE_EXTENSION;
+    if (loadCached(cachePath, options, sourceSize, sourceHash, texture)) return true;
+    if (!build(source, sourcePath, options, texture)) return false;
+    save(cachePath, options, sourceSize, sourceHash, texture);
+    return true;
+}
+
+bool TextureCache::loadCached(const std::string& cachePath, const TextureCacheOptions& options, uint64_t sourceSize, uint64_t sourceHash, TextureData& texture) {
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if (!file->open(cachePath)) return false;
+
+    CacheHeader header;
+    if (file->size() < sizeof(header)) return false;
+    memcpy(&header, file->data(), sizeof(header));
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != TEXTURE_CACHE_VERSION || header.requestedChannels != (uint32_t)options.channels
+        || header.optionFlags != getOptionFlags(options) || header.sourceSize != sourceSize || header.sourceHash != sourceHash) {
+        return false;
+    }
+
+    // the level table and every level has to fit in the file with the size its dimensions call for
+    size_t offset = sizeof(header) + (size_t)header.levelCount * sizeof(CacheLevel);
+    if (header.levelCount == 0 || header.channels < 1 || header.channels > 4 || offset > file->size()) {
+        std::cout << "Texture cache is damaged: " << cachePath << std::endl;
+        return false;
+    }
+    texture.levels.clear();
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        CacheLevel level;
+        memcpy(&level, file->data() + sizeof(header) + i * sizeof(CacheLevel), sizeof(level));
+        if (level.width == 0 || level.height == 0 || level.size != getLevelSize(level.width, level.height, header.channels, header.compressedFormat)
+            || level.size > file->size() - offset) {
+            std::cout << "Texture cache is damaged: " << cachePath << std::endl;
+            texture.levels.clear();
+            return false;
+        }
+        TextureLevel textureLevel = { (int)level.width, (int)level.height, offset, level.size };
+        texture.levels.push_back(textureLevel);
+        offset += level.size;
+    }
+
+    texture.channels = (int)header.channels;
+    texture.compressedFormat = header.compressedFormat;
+    texture.data = file->data();
+    texture.file = std::move(file);
+    return true;
+}
+
+bool TextureCache::build(const MappedFile& source, const std::string& sourcePath, const TextureCacheOptions& options, TextureData& texture) {
+    int width, height, fileChannels;
+    unsigned char* pixels = stbi_load_from_memory(source.data(), (int)source.size(), &width, &height, &fileChannels, options.channels);
+    if (pixels == NULL) return false;
+    int channels = options.channels != 0 ? options.channels : fileChannels;
+
+    // stb_image's flip setting is global and not thread safe to change, so it's left off and flipping is done here
+    if (options.flipVertically) {
+        size_t rowBytes = (size_t)width * channels;
+        std::vector<unsigned char> row(rowBytes);
+        for (int y = 0; y < height / 2; y++) {
+            unsigned char* top = pixels + (size_t)y * rowBytes;
+            unsigned char* bottom = pixels + (size_t)(height - 1 - y) * rowBytes;
+            memcpy(row.data(), top, rowBytes);
+            memcpy(top, bottom, rowBytes);
+            memcpy(bottom, row.data(), rowBytes);
+        }
+    }
+
+    GLenum compressedFormat = 0;
+    if (options.compress && channels == 3) compressedFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    if (options.compress && channels == 4) compressedFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+    texture.channels = channels;
+    texture.compressedFormat = compressedFormat;
+    texture.levels.clear();
+    texture.buffer.clear();
+
+    // each level is box filtered from the one before, like glGenerateMipmap
+    std::vector<unsigned char> level(pixels, pixels + (size_t)width * height * channels);
+    std::vector<unsigned char> next;
+    stbi_image_free(pixels);
+    while (true) {
+        TextureLevel textureLevel = { width, height, texture.buffer.size(), getLevelSize(width, height, channels, compressedFormat) };
+        if (compressedFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || compressedFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) {
+            int size = 0;
+            unsigned char* compressed = compressedFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                ? convert_image_to_DXT1(level.data(), width, height, channels, &size)
+                : convert_image_to_DXT5(level.data(), width, height, channels, &size);
+            if (compressed == NULL || (size_t)size != textureLevel.size) {
+                std::cout << "Failed to compress texture: " << sourcePath << std::endl;
+                free(compressed);
+                return false;
+            }
+            texture.buffer.insert(texture.buffer.end(), compressed, compressed + size);
+            free(compressed);
+        }
+        else {
+            texture.buffer.insert(texture.buffer.end(), level.begin(), level.end());
+        }
+        texture.levels.push_back(textureLevel);
+
+        if (!options.mipmaps || (width == 1 && height == 1)) break;
+        int nextWidth = width > 1 ? width / 2 : 1;
+        int nextHeight = height > 1 ? height / 2 : 1;
+        next.resize((size_t)nextWidth * nextHeight * channels);
+        mipmap_image(level.data(), width, height, channels, next.data(), width > 1 ? 2 : 1, height > 1 ? 2 : 1);
+        level.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+
+    texture.data = texture.buffer.data();
+    return true;
+}
+
+void TextureCache::save(const std::string& cachePath, const TextureCacheOptions& options, uint64_t sourceSize, uint64_t sourceHash, const TextureData& texture) {
+    // written aside and renamed over, so an instance starting meanwhile never maps half a file; the name is
+    // per thread and time, as another thread or instance may be building the same texture
+    std::string tempPath = cachePath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()) ^ (size_t)std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream out(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cout << "Failed to write texture cache: " << cachePath << std::endl;
+            return;
+        }
+
+        CacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.version = TEXTURE_CACHE_VERSION;
+        header.requestedChannels = (uint32_t)options.channels;
+        header.optionFlags = getOptionFlags(options);
+        header.channels = (uint32_t)texture.channels;
+        header.compressedFormat = texture.compressedFormat;
+        header.levelCount = (uint32_t)texture.levels.size();
+        header.sourceSize = sourceSize;
+        header.sourceHash = sourceHash;
+        out.write((const char*)&header, sizeof(header));
+
+        for (unsigned int i = 0; i < texture.levels.size(); i++) {
+            CacheLevel level = { (uint32_t)texture.levels[i].width, (uint32_t)texture.levels[i].height, (uint32_t)texture.levels[i].size };
+            out.write((const char*)&level, sizeof(level));
+        }
+        out.write((const char*)texture.data + texture.levels[0].offset, texture.getSize());
+
+        if (!out) {
+            std::cout << "Failed to write texture cache: " << cachePath << std::endl;
+            out.close();
+            remove(tempPath.c_str());
+            return;
+        }
+    }
+
+    // rename doesn't replace an existing file everywhere
+    remove(cachePath.c_str());
+    if (rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::cout << "Failed to write texture cache: " << cachePath << std::endl;
+        remove(tempPath.c_str());
+    }
+}
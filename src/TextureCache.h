@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Texture cache settings
+// bump whenever the file layout or the way levels are built changes
+const uint32_t TEXTURE_CACHE_VERSION = 1;
+// written next to the source image
+const char* const TEXTURE_CACHE_EXTENSION = ".texcache";
+
+// how a texture is built from its source image; a cache built differently is rebuilt
+struct TextureCacheOptions {
+	TextureCacheOptions(): channels(0), flipVertically(false), mipmaps(false), compress(false) {}
+	// channels to decode to, 0 keeps the file's
+	int channels;
+	bool flipVertically;
+	// the full mip chain down to 1x1, only the base level otherwise
+	bool mipmaps;
+	// DXT1 for RGB and DXT5 for RGBA (S3TC), 1 and 2 channel images stay uncompressed
+	bool compress;
+};
+
+struct TextureLevel {
+	int width, height;
+	size_t offset, size;
+};
+
+// ready to upload levels of one image, in a mapped cache file or built in memory
+struct TextureData {
+	TextureData(): channels(0), compressedFormat(0), data(NULL) {}
+	int channels;
+	// S3TC internal format for glCompressedTexImage2D, 0 for raw channels bytes per pixel
+	GLenum compressedFormat;
+	std::vector<TextureLevel> levels;
+	// NULL if the source couldn't be loaded
+	const unsigned char* data;
+	size_t getSize() const;
+
+	std::unique_ptr<MappedFile> file;
+	std::vector<unsigned char> buffer;
+};
+
+// Precomputed mip chains, block compressed when asked, stored per source image. On a hit loading a texture
+// is a single map of the cache file; on a miss the image is decoded, downsampled with SOIL's mipmap_image,
+// compressed with SOIL's DXT encoder and written out for the next run. A cache is used only if its
+// TEXTURE_CACHE_VERSION and options match and the source file has the same size and FNV-1a hash.
+// Safe to call from several threads at once.
+class TextureCache {
+	public:
+		// false if the source can't be read or decoded
+		static bool load(const std::string& sourcePath, const TextureCacheOptions& options, TextureData& texture);
+
+	private:
+		static bool loadCached(const std::string& cachePath, const TextureCacheOptions& options, uint64_t sourceSize, uint64_t sourceHash, TextureData& texture);
+		static bool build(const MappedFile& source, const std::string& sourcePath, const TextureCacheOptions& options, TextureData& texture);
+		static void save(const std::string& cachePath, const TextureCacheOptions& options, uint64_t sourceSize, uint64_t sourceHash, const TextureData& texture);
+};
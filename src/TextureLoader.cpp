@@ -0,0 +1,255 @@
+#include "TextureLoader.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// shown until the real image is uploaded
+static const unsigned char PLACEHOLDER_PIXEL[4] = { 128, 128, 128, 255 };
+static const unsigned char PLACEHOLDER_SKY_PIXEL[3] = { 150, 190, 230 };
+
+static GLenum getPixelFormat(int channels) {
+    switch (channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+    }
+}
+
+static bool hasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const GLubyte* extension = glGetStringi(GL_EXTENSIONS, i);
+        if (extension != NULL && strcmp((const char*)extension, name) == 0) return true;
+    }
+    return false;
+}
+
+TextureLoader::TextureLoader() : uploadBuffer(0), stopping(false)
+{
+    // without it textures are cached and uploaded uncompressed
+    compress = hasExtension("GL_EXT_texture_compression_s3tc");
+}
+
+TextureLoader::~TextureLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+GLuint TextureLoader::load2D(const std::string& path, bool flipVertically) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER_PIXEL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    Request* request = new Request();
+    request->texture = texture;
+    request->target = GL_TEXTURE_2D;
+    request->flipVertically = flipVertically;
+    request->paths.push_back(path);
+    queue(request);
+    return texture;
+}
+
+GLuint TextureLoader::loadCubeMap(const std::string faces[6]) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for (unsigned int i = 0; i < 6; i++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, PLACEHOLDER_SKY_PIXEL);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    // prevent seam
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    Request* request = new Request();
+    request->texture = texture;
+    request->target = GL_TEXTURE_CUBE_MAP;
+    request->flipVertically = false;
+    request->paths.assign(faces, faces + 6);
+    queue(request);
+    return texture;
+}
+
+void TextureLoader::queue(Request* request) {
+    requests.emplace_back(request);
+    request->images.resize(request->paths.size());
+    request->remaining = (unsigned int)request->paths.size();
+
+    size_t queued;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (unsigned int i = 0; i < request->paths.size(); i++) {
+            DecodeJob job = { request, i };
+            decodeQueue.push_back(job);
+        }
+        queued = decodeQueue.size();
+    }
+
+    // threads are started on demand, so a game without textures to load never starts any
+    unsigned int maxThreads = std::min(TEXTURE_DECODE_THREADS_MAX, std::max(1u, std::thread::hardware_concurrency()));
+    while (threads.size() < maxThreads && threads.size() < queued) {
+        threads.emplace_back(&TextureLoader::workerLoop, this);
+    }
+    wake.notify_all();
+}
+
+void TextureLoader::workerLoop() {
+    Profiler::setThreadName("texture decode");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this]() { return stopping || !decodeQueue.empty(); });
+        if (stopping) return;
+
+        DecodeJob job = decodeQueue.front();
+        decodeQueue.pop_front();
+        lock.unlock();
+        decode(*job.request, job.image);
+        lock.lock();
+
+        if (--job.request->remaining == 0) {
+            readyQueue.push_back(job.request);
+            decoded.notify_all();
+        }
+    }
+}
+
+void TextureLoader::decode(Request& request, unsigned int index) {
+    PROFILE_ZONE("decode texture");
+    TextureCacheOptions options;
+    // cube map faces are always uploaded as RGB, and sampled without mipmaps
+    options.channels = request.target == GL_TEXTURE_CUBE_MAP ? 3 : 0;
+    options.mipmaps = request.target == GL_TEXTURE_2D;
+    options.flipVertically = request.flipVertically;
+    options.compress = compress;
+    if (!TextureCache::load(request.paths[index], options, request.images[index])) {
+        std::cout << "Texture failed to load at path: " << request.paths[index] << std::endl;
+    }
+}
+
+void TextureLoader::update() {
+    PROFILE_ZONE("texture uploads");
+    size_t budget = TEXTURE_UPLOAD_BUDGET;
+    // the first upload of a frame always goes through
+    for (bool first = true; uploadNext(budget, first); first = false) {}
+}
+
+void TextureLoader::finish() {
+    while (!requests.empty()) {
+        size_t budget = 0;
+        while (uploadNext(budget, true)) {}
+        if (requests.empty()) return;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        decoded.wait(lock, [this]() { return !readyQueue.empty(); });
+    }
+}
+
+unsigned int TextureLoader::getPendingCount() const {
+    return (unsigned int)requests.size();
+}
+
+bool TextureLoader::isCompressing() const {
+    return compress;
+}
+
+bool TextureLoader::uploadNext(size_t& budget, bool force) {
+    Request* request;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (readyQueue.empty()) return false;
+        request = readyQueue.front();
+
+        size_t bytes = 0;
+        for (unsigned int i = 0; i < request->images.size(); i++) {
+            bytes += request->images[i].getSize();
+        }
+        if (bytes > budget && !force) return false;
+        budget = bytes > budget ? 0 : budget - bytes;
+        readyQueue.pop_front();
+    }
+
+    upload(*request);
+    remove(request);
+    return true;
+}
+
+void TextureLoader::upload(Request& request) {
+    size_t totalBytes = 0;
+    for (unsigned int i = 0; i < request.images.size(); i++) {
+        // a texture with a missing image keeps its placeholder, a partial cube map would be incomplete
+        if (request.images[i].data == NULL) return;
+        totalBytes += request.images[i].getSize();
+    }
+
+    // the copy into a freshly orphaned buffer doesn't wait on the GPU, and the driver can transfer
+    // from it while the frame goes on
+    if (uploadBuffer == 0) glGenBuffers(1, &uploadBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, totalBytes, NULL, GL_STREAM_DRAW);
+    unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, totalBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    // where each image's levels start: an offset into the buffer, or client memory if it couldn't be mapped
+    std::vector<const unsigned char*> sources;
+    size_t offset = 0;
+    for (unsigned int i = 0; i < request.images.size(); i++) {
+        const TextureData& image = request.images[i];
+        const unsigned char* levels = image.data + image.levels[0].offset;
+        if (mapped != NULL) {
+            memcpy(mapped + offset, levels, image.getSize());
+            sources.push_back((const unsigned char*)offset);
+        }
+        else {
+            sources.push_back(levels);
+        }
+        offset += image.getSize();
+    }
+    if (mapped != NULL)
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    else
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // rows are tightly packed
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(request.target, request.texture);
+    for (unsigned int i = 0; i < request.images.size(); i++) {
+        const TextureData& image = request.images[i];
+        GLenum target = request.target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + i : request.target;
+        GLenum format = getPixelFormat(image.channels);
+        for (unsigned int level = 0; level < image.levels.size(); level++) {
+            const TextureLevel& data = image.levels[level];
+            const unsigned char* pixels = sources[i] + (data.offset - image.levels[0].offset);
+            if (image.compressedFormat != 0)
+                glCompressedTexImage2D(target, level, image.compressedFormat, data.width, data.height, 0, (GLsizei)data.size, pixels);
+            else
+                glTexImage2D(target, level, format, data.width, data.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+        }
+    }
+    // the cached levels are the whole chain
+    glTexParameteri(request.target, GL_TEXTURE_MAX_LEVEL, (GLint)request.images[0].levels.size() - 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureLoader::remove(Request* request) {
+    for (unsigned int r = 0; r < requests.size(); r++) {
+        if (requests[r].get() == request) {
+            requests.erase(requests.begin() + r);
+            return;
+        }
+    }
+}
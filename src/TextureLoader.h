@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "TextureCache.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Texture loader settings
+// decode threads, started with the first request; more than the six skybox faces never helps at startup
+const unsigned int TEXTURE_DECODE_THREADS_MAX = 6;
+// pixel bytes uploaded per update() at most, one texture always goes through so large ones still finish
+const size_t TEXTURE_UPLOAD_BUDGET = 8 * 1024 * 1024;
+
+// Loads image files into GL textures without blocking the GL thread. load2D()/loadCubeMap() create the
+// texture right away with a 1x1 placeholder and queue the files; worker threads load them through the
+// TextureCache (mip chains for 2D textures, S3TC compressed if the driver has it) and update() (once per
+// frame on the GL thread) copies finished ones into a pixel unpack buffer and specifies the texture levels
+// from it, within TEXTURE_UPLOAD_BUDGET. All six faces of a cube map are uploaded together, so it never
+// samples as incomplete. A file that fails to load keeps the placeholder.
+//
+// Everything but the decoding happens on the thread owning the GL context. The destructor only stops the
+// threads, the GL objects stay with the context like the rest of the game's.
+class TextureLoader {
+	public:
+		TextureLoader();
+		~TextureLoader();
+
+		// mipmapped, repeating 2D texture from path
+		GLuint load2D(const std::string& path, bool flipVertically);
+		// clamped cube map from the +X, -X, +Y, -Y, +Z, -Z faces
+		GLuint loadCubeMap(const std::string faces[6]);
+
+		// uploads decoded textures, call once per frame
+		void update();
+		// blocks until every queued texture is uploaded
+		void finish();
+		// textures queued and not uploaded yet
+		unsigned int getPendingCount() const;
+		// whether textures are stored S3TC compressed
+		bool isCompressing() const;
+
+	private:
+		struct Request {
+			GLuint texture;
+			GLenum target;
+			bool flipVertically;
+			std::vector<std::string> paths;
+			std::vector<TextureData> images;
+			// images not decoded yet, guarded by mutex
+			unsigned int remaining;
+		};
+
+		struct DecodeJob {
+			Request* request;
+			unsigned int image;
+		};
+
+		// only touched on the GL thread
+		std::vector<std::unique_ptr<Request>> requests;
+		GLuint uploadBuffer;
+		// GL_EXT_texture_compression_s3tc is there
+		bool compress;
+
+		mutable std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable decoded;
+		std::deque<DecodeJob> decodeQueue;
+		// fully decoded requests in the order they finished
+		std::deque<Request*> readyQueue;
+		bool stopping;
+		std::vector<std::thread> threads;
+
+		void queue(Request* request);
+		void workerLoop();
+		void decode(Request& request, unsigned int image);
+
+		// uploads the oldest ready texture if it fits budget (or force), false if it didn't or nothing was ready
+		bool uploadNext(size_t& budget, bool force);
+		void upload(Request& request);
+		void remove(Request* request);
+};
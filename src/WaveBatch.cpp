@@ -0,0 +1,123 @@
+#include "WaveBatch.h"
+#include <cmath>
+
+#if WAVES_HAS_X86_SIMD && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static bool cpuSupportsSse2() {
+#if !WAVES_HAS_X86_SIMD
+    return false;
+#elif defined(__x86_64__) || defined(_M_X64)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool cpuSupportsAvx2() {
+#if !WAVES_HAS_X86_SIMD
+    return false;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !avx || !fma) return false;
+    // the OS has to save the ymm registers too
+    if ((_xgetbv(0) & 6) != 6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+static WaveBatch::Path currentPath = WaveBatch::detectPath();
+
+WaveBatch::Path WaveBatch::detectPath() {
+    if (cpuSupportsAvx2()) return AVX2;
+    if (cpuSupportsSse2()) return SSE;
+    return SCALAR;
+}
+
+WaveBatch::Path WaveBatch::getPath() {
+    return currentPath;
+}
+
+void WaveBatch::setPath(Path path) {
+    Path best = detectPath();
+    currentPath = path <= best ? path : best;
+}
+
+const char* WaveBatch::getPathName(Path path) {
+    switch (path) {
+    case AVX2: return "avx2";
+    case SSE: return "sse";
+    default: return "scalar";
+    }
+}
+
+void WaveBatch::sample(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs) {
+    switch (currentPath) {
+    case AVX2:
+        sampleAvx2(spectrum, quality, time, xs, zs, count, heights, dxs, dzs);
+        break;
+    case SSE:
+        sampleSse(spectrum, quality, time, xs, zs, count, heights, dxs, dzs);
+        break;
+    default:
+        sampleScalar(spectrum, quality, time, xs, zs, count, heights, dxs, dzs);
+        break;
+    }
+}
+
+void WaveBatch::sampleFew(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs) {
+    if (currentPath == SCALAR)
+        sampleScalar(spectrum, quality, time, xs, zs, count, heights, dxs, dzs);
+    else
+        sampleSse(spectrum, quality, time, xs, zs, count, heights, dxs, dzs);
+}
+
+void WaveBatch::sampleScalar(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs) {
+    int octaves = getWaveQualityOctaves(quality);
+    bool warp = isWaveQualityWarped(quality);
+
+    for (int p = 0; p < count; p++) {
+        float height = 0.0f;
+        float dx = 0.0f;
+        float dz = 0.0f;
+
+        for (int i = 0; i < octaves; i++) {
+            float a = WAVE_OCTAVES.amplitude[i];
+            float f = WAVE_OCTAVES.frequency[i];
+
+            float offset = spectrum.dirX[i] * xs[p] + spectrum.dirZ[i] * zs[p];
+            if (warp) offset += dx + dz;
+            float dotPhase = offset * f + time * WAVE_OCTAVES.phaseSpeed[i];
+            float sine = std::sin(dotPhase);
+            float cosine = std::cos(dotPhase);
+            float exponent = std::exp(sine - 1.0f);
+
+            height += a * exponent;
+            dx += spectrum.dirX[i] * a * cosine * exponent * f;
+            dz += spectrum.dirZ[i] * a * cosine * exponent * f;
+        }
+
+        heights[p] = height;
+        dxs[p] = dx;
+        dzs[p] = dz;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "WaveSpectrum.h"
+#include "WaveKernel.h"
+
+// Batched evaluation of the sum of sines ocean: heights and slopes for many (x, z) points per call.
+// Picks an AVX2 (8 lanes), SSE2 (4 lanes) or scalar kernel at runtime from the CPU features.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define WAVES_HAS_X86_SIMD 1
+#else
+#define WAVES_HAS_X86_SIMD 0
+#endif
+
+class WaveBatch {
+	public:
+		enum Path {
+			SCALAR,
+			SSE,
+			AVX2
+		};
+
+		// best path this CPU supports
+		static Path detectPath();
+		static Path getPath();
+		// forces a path (for comparisons and benchmarks), falls back to the best supported one if unavailable
+		static void setPath(Path path);
+		static const char* getPathName(Path path);
+
+		// writes the raw surface height and the summed x/z slopes for count points, using the octave count
+		// and warp mode of the given preset
+		static void sample(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs);
+		// the same for a few points (single queries): SSE2 unless the scalar path is forced or the only one,
+		// as wider registers would only be padding
+		static void sampleFew(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs);
+
+		// plain loop with the float std::sin/cos/exp, also the reference the SIMD paths are compared against
+		static void sampleScalar(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs);
+		static void sampleSse(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs);
+		static void sampleAvx2(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs);
+};
@@ -0,0 +1,71 @@
+// AVX2 + FMA path of WaveBatch: 8 points per register. Everything in this file is compiled for AVX2
+// (through the pragmas below on gcc/clang, MSVC allows the intrinsics anywhere), and is only ever
+// called after WaveBatch::detectPath() has checked the CPU.
+#include "WaveBatch.h"
+
+#if WAVES_HAS_X86_SIMD
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC target("avx2,fma")
+#endif
+
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#endif
+
+namespace {
+    struct Avx8 {
+        static const int WIDTH = 8;
+        __m256 v;
+
+        Avx8() {}
+        Avx8(__m256 v) : v(v) {}
+
+        static Avx8 set1(float f) { return _mm256_set1_ps(f); }
+        static Avx8 load(const float* p) { return _mm256_loadu_ps(p); }
+        void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+        static Avx8 fmadd(Avx8 a, Avx8 b, Avx8 c) { return _mm256_fmadd_ps(a.v, b.v, c.v); }
+
+        static Avx8 round(Avx8 a) { return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static Avx8 clamp(Avx8 a, Avx8 lo, Avx8 hi) { return _mm256_min_ps(_mm256_max_ps(a.v, lo.v), hi.v); }
+
+        // all bits set in lanes where the integer value of a has the given bit
+        static Avx8 bitSet(Avx8 a, int bit) {
+            __m256i b = _mm256_set1_epi32(bit);
+            return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_cvtps_epi32(a.v), b), b));
+        }
+        static Avx8 select(Avx8 mask, Avx8 a, Avx8 b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+        static Avx8 negateWhere(Avx8 a, Avx8 mask) { return _mm256_xor_ps(a.v, _mm256_and_ps(mask.v, _mm256_set1_ps(-0.0f))); }
+        // a * 2^n for integral n, built straight into the exponent bits
+        static Avx8 scaleByPow2(Avx8 a, Avx8 n) {
+            __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127)), 23);
+            return _mm256_mul_ps(a.v, _mm256_castsi256_ps(e));
+        }
+    };
+
+    // free functions rather than friends: gcc does not apply the target pragma to friends defined in the class
+    inline Avx8 operator+(Avx8 a, Avx8 b) { return _mm256_add_ps(a.v, b.v); }
+    inline Avx8 operator-(Avx8 a, Avx8 b) { return _mm256_sub_ps(a.v, b.v); }
+    inline Avx8 operator*(Avx8 a, Avx8 b) { return _mm256_mul_ps(a.v, b.v); }
+}
+
+#include "WaveBatchSimd.h"
+
+void WaveBatch::sampleAvx2(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs) {
+    waveSampleBatchPreset<Avx8>(spectrum, quality, time, xs, zs, count, heights, dxs, dzs);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+#else
+
+void WaveBatch::sampleAvx2(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs) {
+    sampleScalar(spectrum, quality, time, xs, zs, count, heights, dxs, dzs);
+}
+
+#endif
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "WaveBatch.h"
+
+// Lane-width independent WaveKernel evaluation, shared by WaveBatchSse.cpp and WaveBatchAvx2.cpp.
+// V is a small wrapper over one SIMD register that each of those files defines (in an anonymous
+// namespace, so every instantiation below stays local to the file that was compiled for its ISA):
+//   WIDTH, set1, load, store, + - *, fmadd, round, bitSet, select, negateWhere, scaleByPow2, clamp
+
+// sin and cos together, cephes style: reduce to [-pi/4, pi/4] around the nearest multiple of pi/2,
+// then pick/negate the polynomials by quadrant
+template <typename V>
+inline void waveSinCos(V x, V& sine, V& cosine) {
+    V q = V::round(x * V::set1(0.63661977236758134f)); // 2 / pi
+    // pi / 2 split in three so the reduction stays exact for large arguments
+    V r = V::fmadd(q, V::set1(-1.5703125f), x);
+    r = V::fmadd(q, V::set1(-4.837512969970703125e-4f), r);
+    r = V::fmadd(q, V::set1(-7.54978995489188216e-8f), r);
+
+    V r2 = r * r;
+    V s = V::fmadd(r2, V::set1(-1.9515295891e-4f), V::set1(8.3321608736e-3f));
+    s = V::fmadd(s, r2, V::set1(-1.6666654611e-1f));
+    s = V::fmadd(s * r2, r, r);
+
+    V c = V::fmadd(r2, V::set1(2.443315711809948e-5f), V::set1(-1.388731625493765e-3f));
+    c = V::fmadd(c, r2, V::set1(4.166664568298827e-2f));
+    c = V::fmadd(c * r2, r2, V::fmadd(r2, V::set1(-0.5f), V::set1(1.0f)));
+
+    V swap = V::bitSet(q, 1);
+    sine = V::negateWhere(V::select(swap, c, s), V::bitSet(q, 2));
+    cosine = V::negateWhere(V::select(swap, s, c), V::bitSet(q + V::set1(1.0f), 2));
+}
+
+// e^x, cephes style: split off the power of two, polynomial for the remainder
+template <typename V>
+inline V waveExp(V x) {
+    x = V::clamp(x, V::set1(-87.0f), V::set1(87.0f));
+    V n = V::round(x * V::set1(1.44269504088896341f)); // log2(e)
+    V r = V::fmadd(n, V::set1(-0.693359375f), x);
+    r = V::fmadd(n, V::set1(2.12194440e-4f), r);
+
+    V p = V::fmadd(r, V::set1(1.9875691500e-4f), V::set1(1.3981999507e-3f));
+    p = V::fmadd(p, r, V::set1(8.3334519073e-3f));
+    p = V::fmadd(p, r, V::set1(4.1665795894e-2f));
+    p = V::fmadd(p, r, V::set1(1.6666665459e-1f));
+    p = V::fmadd(p, r, V::set1(5.0000001201e-1f));
+    p = V::fmadd(p, r * r, r + V::set1(1.0f));
+
+    return V::scaleByPow2(p, n);
+}
+
+// one octave of Kernel, then recurses into the next one, so the whole sum is unrolled with the
+// octave coefficients as constants; only the random directions come from the spectrum
+template <typename Kernel, int I, int Remaining>
+struct WaveKernelOctave {
+    template <typename V>
+    static inline void accumulate(const WaveSpectrum& spectrum, const float* timePhase, V x, V z, V& height, V& dx, V& dz) {
+        V dirX = V::set1(spectrum.dirX[I]);
+        V dirZ = V::set1(spectrum.dirZ[I]);
+        V f = V::set1(Kernel::frequency(I));
+
+        V offset = V::fmadd(dirX, x, dirZ * z);
+        if (Kernel::WARP == WAVE_WARP_DOMAIN) offset = offset + dx + dz;
+        V dotPhase = V::fmadd(offset, f, V::set1(timePhase[I]));
+        V sine, cosine;
+        waveSinCos(dotPhase, sine, cosine);
+        V exponent = waveExp(sine - V::set1(1.0f));
+
+        V a = V::set1(Kernel::amplitude(I)) * exponent;
+        height = height + a;
+        V slope = a * cosine * f;
+        dx = V::fmadd(dirX, slope, dx);
+        dz = V::fmadd(dirZ, slope, dz);
+
+        WaveKernelOctave<Kernel, I + 1, Remaining - 1>::accumulate(spectrum, timePhase, x, z, height, dx, dz);
+    }
+};
+
+template <typename Kernel, int I>
+struct WaveKernelOctave<Kernel, I, 0> {
+    template <typename V>
+    static inline void accumulate(const WaveSpectrum&, const float*, V, V, V&, V&, V&) {}
+};
+
+template <typename Kernel, typename V>
+inline void waveSampleLanes(const WaveSpectrum& spectrum, const float* timePhase, V x, V z, V& height, V& dx, V& dz) {
+    height = V::set1(0.0f);
+    dx = V::set1(0.0f);
+    dz = V::set1(0.0f);
+    WaveKernelOctave<Kernel, 0, Kernel::OCTAVES>::accumulate(spectrum, timePhase, x, z, height, dx, dz);
+}
+
+template <typename Kernel, typename V>
+void waveSampleBatch(const WaveSpectrum& spectrum, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs) {
+    float timePhase[Kernel::OCTAVES];
+    for (int i = 0; i < Kernel::OCTAVES; i++) {
+        timePhase[i] = time * Kernel::phaseSpeed(i);
+    }
+
+    V height, dx, dz;
+    int p = 0;
+    for (; p + V::WIDTH <= count; p += V::WIDTH) {
+        waveSampleLanes<Kernel>(spectrum, timePhase, V::load(xs + p), V::load(zs + p), height, dx, dz);
+        height.store(heights + p);
+        dx.store(dxs + p);
+        dz.store(dzs + p);
+    }
+
+    // leftover points go through one padded register
+    int left = count - p;
+    if (left > 0) {
+        float x[V::WIDTH] = {}, z[V::WIDTH] = {};
+        float h[V::WIDTH], sx[V::WIDTH], sz[V::WIDTH];
+        for (int i = 0; i < left; i++) {
+            x[i] = xs[p + i];
+            z[i] = zs[p + i];
+        }
+        waveSampleLanes<Kernel>(spectrum, timePhase, V::load(x), V::load(z), height, dx, dz);
+        height.store(h);
+        dx.store(sx);
+        dz.store(sz);
+        for (int i = 0; i < left; i++) {
+            heights[p + i] = h[i];
+            dxs[p + i] = sx[i];
+            dzs[p + i] = sz[i];
+        }
+    }
+}
+
+template <typename V>
+void waveSampleBatchPreset(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs) {
+    switch (quality) {
+    case WAVES_QUALITY_LOW:
+        waveSampleBatch<WaveKernelLow, V>(spectrum, time, xs, zs, count, heights, dxs, dzs);
+        break;
+    case WAVES_QUALITY_LOW_WARPED:
+        waveSampleBatch<WaveKernelLowWarped, V>(spectrum, time, xs, zs, count, heights, dxs, dzs);
+        break;
+    case WAVES_QUALITY_MEDIUM:
+        waveSampleBatch<WaveKernelMedium, V>(spectrum, time, xs, zs, count, heights, dxs, dzs);
+        break;
+    case WAVES_QUALITY_MEDIUM_WARPED:
+        waveSampleBatch<WaveKernelMediumWarped, V>(spectrum, time, xs, zs, count, heights, dxs, dzs);
+        break;
+    case WAVES_QUALITY_HIGH:
+        waveSampleBatch<WaveKernelHigh, V>(spectrum, time, xs, zs, count, heights, dxs, dzs);
+        break;
+    default:
+        waveSampleBatch<WaveKernelHighWarped, V>(spectrum, time, xs, zs, count, heights, dxs, dzs);
+        break;
+    }
+}
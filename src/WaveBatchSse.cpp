@@ -0,0 +1,56 @@
+// SSE2 path of WaveBatch: 4 points per register. SSE2 is part of every x86-64 CPU, so no extra compiler flags are needed.
+#include "WaveBatch.h"
+
+#if WAVES_HAS_X86_SIMD
+#include <emmintrin.h>
+
+namespace {
+    struct Sse4 {
+        static const int WIDTH = 4;
+        __m128 v;
+
+        Sse4() {}
+        Sse4(__m128 v) : v(v) {}
+
+        static Sse4 set1(float f) { return _mm_set1_ps(f); }
+        static Sse4 load(const float* p) { return _mm_loadu_ps(p); }
+        void store(float* p) const { _mm_storeu_ps(p, v); }
+
+        static Sse4 fmadd(Sse4 a, Sse4 b, Sse4 c) { return _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v); }
+
+        // SSE2 has no round instruction, go through int with the default round to nearest mode
+        static Sse4 round(Sse4 a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)); }
+        static Sse4 clamp(Sse4 a, Sse4 lo, Sse4 hi) { return _mm_min_ps(_mm_max_ps(a.v, lo.v), hi.v); }
+
+        // all bits set in lanes where the integer value of a has the given bit
+        static Sse4 bitSet(Sse4 a, int bit) {
+            __m128i b = _mm_set1_epi32(bit);
+            return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_cvtps_epi32(a.v), b), b));
+        }
+        static Sse4 select(Sse4 mask, Sse4 a, Sse4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+        static Sse4 negateWhere(Sse4 a, Sse4 mask) { return _mm_xor_ps(a.v, _mm_and_ps(mask.v, _mm_set1_ps(-0.0f))); }
+        // a * 2^n for integral n, built straight into the exponent bits
+        static Sse4 scaleByPow2(Sse4 a, Sse4 n) {
+            __m128i e = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n.v), _mm_set1_epi32(127)), 23);
+            return _mm_mul_ps(a.v, _mm_castsi128_ps(e));
+        }
+    };
+
+    inline Sse4 operator+(Sse4 a, Sse4 b) { return _mm_add_ps(a.v, b.v); }
+    inline Sse4 operator-(Sse4 a, Sse4 b) { return _mm_sub_ps(a.v, b.v); }
+    inline Sse4 operator*(Sse4 a, Sse4 b) { return _mm_mul_ps(a.v, b.v); }
+}
+
+#include "WaveBatchSimd.h"
+
+void WaveBatch::sampleSse(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs) {
+    waveSampleBatchPreset<Sse4>(spectrum, quality, time, xs, zs, count, heights, dxs, dzs);
+}
+
+#else
+
+void WaveBatch::sampleSse(const WaveSpectrum& spectrum, WaveQuality quality, float time, const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs) {
+    sampleScalar(spectrum, quality, time, xs, zs, count, heights, dxs, dzs);
+}
+
+#endif
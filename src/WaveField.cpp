@@ -0,0 +1,113 @@
+#include "WaveField.h"
+#include "Random.h"
+#include <cmath>
+
+WaveField::WaveField() : time(0.0f) {
+    for (int i = 0; i < NUM_OF_WAVE_DIRECTIONS; i++) {
+        directions[i] = glm::vec3(1.0f, 0.0f, 0.0f);
+    }
+    spectrum.build(directions, NUM_OF_WAVE_DIRECTIONS);
+}
+
+void WaveField::init() {
+    time = 0.0f;
+    for (int i = 0; i < NUM_OF_WAVE_DIRECTIONS; i++) {
+        directions[i] = glm::vec3(Random::randFloat(1.0f), 0.0f, Random::randFloat(1.0f));
+    }
+    spectrum.build(directions, NUM_OF_WAVE_DIRECTIONS);
+}
+
+void WaveField::advance(float dt) {
+    time += dt;
+}
+
+float WaveField::getTime() const {
+    return time;
+}
+
+const glm::vec3& WaveField::getDirection(int i) const {
+    return directions[i % NUM_OF_WAVE_DIRECTIONS];
+}
+
+const WaveSpectrum& WaveField::getSpectrum() const {
+    return spectrum;
+}
+
+glm::vec3 WaveField::sample(glm::vec3 position, glm::vec3& normal, WaveQuality quality) const {
+    float height, dx, dz;
+    WaveBatch::sampleFew(spectrum, quality, time, &position.x, &position.z, 1, &height, &dx, &dz);
+
+    height *= BOAT_HEIGHT_DAMPING_FACTOR;
+    height += BOAT_HEIGHT_FLOATING_OFFSET;
+
+    normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+
+    return glm::vec3(position.x + dx, height, position.z + dz);
+}
+
+void WaveField::sampleBatch(const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs, WaveQuality quality) const {
+    WaveBatch::sample(spectrum, quality, time, xs, zs, count, heights, dxs, dzs);
+
+    for (int i = 0; i < count; i++) {
+        heights[i] = heights[i] * BOAT_HEIGHT_DAMPING_FACTOR + BOAT_HEIGHT_FLOATING_OFFSET;
+    }
+}
+
+void WaveField::averageSamples(const float* heights, const float* dxs, const float* dzs, int first, glm::vec3 position, glm::vec3& target, glm::vec3& normal) const {
+    const int sampleCount = WAVES_SAMPLE_GRID_SIZE * WAVES_SAMPLE_GRID_SIZE;
+
+    float heightSum = 0.0f;
+    glm::vec3 normalSum = glm::vec3(0.0f);
+    for (int i = first; i < first + sampleCount; i++) {
+        heightSum += heights[i];
+        normalSum += glm::normalize(glm::vec3(-dxs[i], 1.0f, -dzs[i]));
+    }
+
+    target = glm::vec3(position.x, heightSum / (float)sampleCount, position.z);
+    normal = glm::normalize(normalSum / (float)sampleCount);
+}
+
+glm::vec3 WaveField::sampleAverage(glm::vec3 position, glm::vec3& normal, WaveQuality quality) const {
+    const int sampleCount = WAVES_SAMPLE_GRID_SIZE * WAVES_SAMPLE_GRID_SIZE;
+    float xs[sampleCount], zs[sampleCount], heights[sampleCount], dxs[sampleCount], dzs[sampleCount];
+
+    float startingOffset = -WAVES_SAMPLE_SPACING * ((float)(WAVES_SAMPLE_GRID_SIZE - 1) / 2.0f);
+    for (unsigned int i = 0; i < WAVES_SAMPLE_GRID_SIZE; i++) {
+        for (unsigned int j = 0; j < WAVES_SAMPLE_GRID_SIZE; j++) {
+            xs[i * WAVES_SAMPLE_GRID_SIZE + j] = startingOffset + WAVES_SAMPLE_SPACING * (float)i + position.x;
+            zs[i * WAVES_SAMPLE_GRID_SIZE + j] = startingOffset + WAVES_SAMPLE_SPACING * (float)j + position.z;
+        }
+    }
+    sampleBatch(xs, zs, sampleCount, heights, dxs, dzs, quality);
+
+    glm::vec3 pos;
+    averageSamples(heights, dxs, dzs, 0, position, pos, normal);
+    return pos;
+}
+
+void WaveField::sampleAverageBatch(const glm::vec3* positions, int count, WaveSampleBuffer& buffer, glm::vec3* targets, glm::vec3* normals, WaveQuality quality) const {
+    const int sampleCount = WAVES_SAMPLE_GRID_SIZE * WAVES_SAMPLE_GRID_SIZE;
+    size_t total = (size_t)count * sampleCount;
+    buffer.xs.resize(total);
+    buffer.zs.resize(total);
+    buffer.heights.resize(total);
+    buffer.dxs.resize(total);
+    buffer.dzs.resize(total);
+
+    float startingOffset = -WAVES_SAMPLE_SPACING * ((float)(WAVES_SAMPLE_GRID_SIZE - 1) / 2.0f);
+    size_t k = 0;
+    for (int b = 0; b < count; b++) {
+        for (unsigned int i = 0; i < WAVES_SAMPLE_GRID_SIZE; i++) {
+            for (unsigned int j = 0; j < WAVES_SAMPLE_GRID_SIZE; j++) {
+                buffer.xs[k] = startingOffset + WAVES_SAMPLE_SPACING * (float)i + positions[b].x;
+                buffer.zs[k] = startingOffset + WAVES_SAMPLE_SPACING * (float)j + positions[b].z;
+                k++;
+            }
+        }
+    }
+    sampleBatch(buffer.xs.data(), buffer.zs.data(), (int)total, buffer.heights.data(), buffer.dxs.data(), buffer.dzs.data(), quality);
+
+    for (int b = 0; b < count; b++) {
+        averageSamples(buffer.heights.data(), buffer.dxs.data(), buffer.dzs.data(), b * sampleCount, positions[b], targets[b], normals[b]);
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "WaveBatch.h"
+
+#include <vector>
+
+// Wave sampling settings
+const float BOAT_HEIGHT_DAMPING_FACTOR = 0.95f;
+const float BOAT_HEIGHT_FLOATING_OFFSET = -0.5f;
+const unsigned int WAVES_SAMPLE_GRID_SIZE = 5;
+const float WAVES_SAMPLE_SPACING = 0.25f;
+
+// scratch space for batched queries, kept around so repeated calls don't allocate
+struct WaveSampleBuffer {
+	std::vector<float> xs;
+	std::vector<float> zs;
+	std::vector<float> heights;
+	std::vector<float> dxs;
+	std::vector<float> dzs;
+};
+
+// CPU side of the sum of sines ocean. Holds the random wave directions and the wave clock,
+// and samples the surface the same way waves.vs does. Has no GL dependency.
+class WaveField {
+	public:
+		WaveField();
+
+		// picks new random wave directions and resets the clock
+		void init();
+		void advance(float dt);
+
+		float getTime() const;
+		const glm::vec3& getDirection(int i) const;
+		const WaveSpectrum& getSpectrum() const;
+
+		// returns the floating position of a boat at the given position, and the surface normal there.
+		// quality picks the WaveKernel preset, the default matches what waves.vs draws
+		glm::vec3 sample(glm::vec3 position, glm::vec3& normal, WaveQuality quality = WAVES_RENDER_QUALITY) const;
+		// averages sample() over a WAVES_SAMPLE_GRID_SIZE x WAVES_SAMPLE_GRID_SIZE grid around position
+		glm::vec3 sampleAverage(glm::vec3 position, glm::vec3& normal, WaveQuality quality = WAVES_RENDER_QUALITY) const;
+
+		// floating heights (damped and offset like sample()) and x/z slopes for count points, through WaveBatch
+		void sampleBatch(const float* xs, const float* zs, int count, float* heights, float* dxs, float* dzs, WaveQuality quality = WAVES_RENDER_QUALITY) const;
+		// sampleAverage() for count positions at once, all sample points go through one sampleBatch() call
+		void sampleAverageBatch(const glm::vec3* positions, int count, WaveSampleBuffer& buffer, glm::vec3* targets, glm::vec3* normals, WaveQuality quality = WAVES_RENDER_QUALITY) const;
+
+	private:
+		float time;
+		glm::vec3 directions[NUM_OF_WAVE_DIRECTIONS];
+		WaveSpectrum spectrum;
+
+		// averages the sample points of one sampleAverage() grid starting at index first
+		void averageSamples(const float* heights, const float* dxs, const float* dzs, int first, glm::vec3 position, glm::vec3& target, glm::vec3& normal) const;
+};
@@ -0,0 +1,118 @@
+#include "WaveHeightfield.h"
+#include <cmath>
+
+WaveHeightfield::WaveHeightfield() : isBaked(false), timeSinceBake(0.0f), originX(0.0f), originZ(0.0f) {
+    configure(WAVES_HEIGHTFIELD_RESOLUTION, WAVES_HEIGHTFIELD_SPACING, WAVES_HEIGHTFIELD_REBAKE_INTERVAL);
+}
+
+void WaveHeightfield::configure(int resolution, float spacing, float rebakeInterval, Filter filter) {
+    this->resolution = resolution;
+    this->spacing = spacing;
+    this->rebakeInterval = rebakeInterval;
+    this->filter = filter;
+    invalidate();
+}
+
+void WaveHeightfield::invalidate() {
+    isBaked = false;
+}
+
+void WaveHeightfield::update(const WaveField& waves, glm::vec3 center, float dt) {
+    timeSinceBake += dt;
+    if (isBaked && timeSinceBake < rebakeInterval) return;
+    bake(waves, center);
+}
+
+void WaveHeightfield::bake(const WaveField& waves, glm::vec3 center) {
+    float halfExtent = spacing * (float)(resolution - 1) * 0.5f;
+    originX = floor((center.x - halfExtent) / spacing) * spacing;
+    originZ = floor((center.z - halfExtent) / spacing) * spacing;
+
+    size_t count = (size_t)resolution * resolution;
+    bakeBuffer.xs.resize(count);
+    bakeBuffer.zs.resize(count);
+    heights.resize(count);
+    dxs.resize(count);
+    dzs.resize(count);
+
+    for (int z = 0; z < resolution; z++) {
+        for (int x = 0; x < resolution; x++) {
+            bakeBuffer.xs[z * resolution + x] = originX + spacing * (float)x;
+            bakeBuffer.zs[z * resolution + x] = originZ + spacing * (float)z;
+        }
+    }
+    waves.sampleBatch(bakeBuffer.xs.data(), bakeBuffer.zs.data(), (int)count, heights.data(), dxs.data(), dzs.data(), WAVES_HEIGHTFIELD_QUALITY);
+
+    isBaked = true;
+    timeSinceBake = 0.0f;
+}
+
+static float catmullRom(float p0, float p1, float p2, float p3, float t) {
+    return p1 + 0.5f * t * (p2 - p0 + t * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3 + t * (3.0f * (p1 - p2) + p3 - p0)));
+}
+
+float WaveHeightfield::filterGrid(const std::vector<float>& grid, int cellX, int cellZ, float tx, float tz) const {
+    if (filter == BICUBIC && cellX > 0 && cellZ > 0 && cellX < resolution - 2 && cellZ < resolution - 2) {
+        float rows[4];
+        for (int j = 0; j < 4; j++) {
+            const float* row = &grid[(cellZ - 1 + j) * resolution + cellX - 1];
+            rows[j] = catmullRom(row[0], row[1], row[2], row[3], tx);
+        }
+        return catmullRom(rows[0], rows[1], rows[2], rows[3], tz);
+    }
+
+    const float* row0 = &grid[cellZ * resolution + cellX];
+    const float* row1 = row0 + resolution;
+    float top = row0[0] + (row0[1] - row0[0]) * tx;
+    float bottom = row1[0] + (row1[1] - row1[0]) * tx;
+    return top + (bottom - top) * tz;
+}
+
+bool WaveHeightfield::lookup(float x, float z, float& height, float& dx, float& dz) const {
+    if (!isBaked) return false;
+
+    float gx = (x - originX) / spacing;
+    float gz = (z - originZ) / spacing;
+    if (gx < 0.0f || gz < 0.0f || gx >= (float)(resolution - 1) || gz >= (float)(resolution - 1)) return false;
+
+    int cellX = (int)gx;
+    int cellZ = (int)gz;
+    float tx = gx - (float)cellX;
+    float tz = gz - (float)cellZ;
+
+    height = filterGrid(heights, cellX, cellZ, tx, tz);
+    dx = filterGrid(dxs, cellX, cellZ, tx, tz);
+    dz = filterGrid(dzs, cellX, cellZ, tx, tz);
+    return true;
+}
+
+bool WaveHeightfield::sample(glm::vec3 position, glm::vec3& result, glm::vec3& normal) const {
+    float height, dx, dz;
+    if (!lookup(position.x, position.z, height, dx, dz)) return false;
+
+    normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+    result = glm::vec3(position.x + dx, height, position.z + dz);
+    return true;
+}
+
+bool WaveHeightfield::sampleAverage(glm::vec3 position, glm::vec3& target, glm::vec3& normal) const {
+    float heightSum = 0.0f;
+    glm::vec3 normalSum = glm::vec3(0.0f);
+
+    float startingOffset = -WAVES_SAMPLE_SPACING * ((float)(WAVES_SAMPLE_GRID_SIZE - 1) / 2.0f);
+    for (unsigned int i = 0; i < WAVES_SAMPLE_GRID_SIZE; i++) {
+        for (unsigned int j = 0; j < WAVES_SAMPLE_GRID_SIZE; j++) {
+            float x = startingOffset + WAVES_SAMPLE_SPACING * (float)i + position.x;
+            float z = startingOffset + WAVES_SAMPLE_SPACING * (float)j + position.z;
+            float height, dx, dz;
+            if (!lookup(x, z, height, dx, dz)) return false;
+            heightSum += height;
+            normalSum += glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+        }
+    }
+
+    const float sampleCount = (float)(WAVES_SAMPLE_GRID_SIZE * WAVES_SAMPLE_GRID_SIZE);
+    target = glm::vec3(position.x, heightSum / sampleCount, position.z);
+    normal = glm::normalize(normalSum / sampleCount);
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "WaveField.h"
+
+#include <vector>
+
+// Heightfield settings
+const int WAVES_HEIGHTFIELD_RESOLUTION = 128;
+// below half the shortest wavelength (about 0.53 m for the 36th octave), so no octave aliases; the grid then
+// covers about 32 m around the player. Against direct sampling the 5x5 buoyancy average is off by about
+// 2 mm on average (1.2 cm at most) and its normal by about 0.6 degrees; at 2 m spacing it was 8.5 cm
+// (45 cm) and 9.4 degrees, so toggling the heightfield visibly changed how the boats float
+constexpr float WAVES_HEIGHTFIELD_SPACING = 0.25f;
+// seconds between bakes, 0 bakes every update
+const float WAVES_HEIGHTFIELD_REBAKE_INTERVAL = 0.05f;
+// same preset as the rendered surface: every octave lifts the mean height, so a cheaper one sinks the boats
+const WaveQuality WAVES_HEIGHTFIELD_QUALITY = WAVES_RENDER_QUALITY;
+
+static_assert(WAVES_HEIGHTFIELD_SPACING < 0.5f * 6.28318530718f / WAVE_OCTAVES.frequency[NUM_OF_SINE_WAVES - 1], "the heightfield would alias the shortest octave");
+
+// The wave surface around a point (the player) baked into a grid of heights and slopes, so buoyancy and
+// camera queries become a few grid lookups instead of a full wave evaluation each. Queries outside the
+// grid return false and the caller falls back to WaveField.
+class WaveHeightfield {
+	public:
+		enum Filter {
+			BILINEAR,
+			BICUBIC
+		};
+
+		WaveHeightfield();
+
+		void configure(int resolution, float spacing, float rebakeInterval, Filter filter = BILINEAR);
+
+		// rebakes around center once the rebake interval has passed (or the grid was never baked)
+		void update(const WaveField& waves, glm::vec3 center, float dt);
+		// drops the baked grid, the next update() bakes again
+		void invalidate();
+
+		// floating height and x/z slopes at (x, z), same values WaveField::sampleBatch() returns
+		bool lookup(float x, float z, float& height, float& dx, float& dz) const;
+		// WaveField::sample() and WaveField::sampleAverage() from the grid
+		bool sample(glm::vec3 position, glm::vec3& result, glm::vec3& normal) const;
+		bool sampleAverage(glm::vec3 position, glm::vec3& target, glm::vec3& normal) const;
+
+	private:
+		int resolution;
+		float spacing;
+		float rebakeInterval;
+		Filter filter;
+
+		bool isBaked;
+		float timeSinceBake;
+		// world position of grid point (0, 0), kept on multiples of spacing so the samples don't swim
+		float originX;
+		float originZ;
+
+		std::vector<float> heights;
+		std::vector<float> dxs;
+		std::vector<float> dzs;
+		WaveSampleBuffer bakeBuffer;
+
+		void bake(const WaveField& waves, glm::vec3 center);
+		float filterGrid(const std::vector<float>& grid, int cellX, int cellZ, float tx, float tz) const;
+};
@@ -0,0 +1,54 @@
+#include "WaveKernel.h"
+#include <sstream>
+#include <iomanip>
+
+int getWaveQualityOctaves(WaveQuality quality) {
+    switch (quality) {
+    case WAVES_QUALITY_LOW:
+    case WAVES_QUALITY_LOW_WARPED:
+        return WaveKernelLow::OCTAVES;
+    case WAVES_QUALITY_MEDIUM:
+    case WAVES_QUALITY_MEDIUM_WARPED:
+        return WaveKernelMedium::OCTAVES;
+    default:
+        return WaveKernelHigh::OCTAVES;
+    }
+}
+
+bool isWaveQualityWarped(WaveQuality quality) {
+    return quality == WAVES_QUALITY_LOW_WARPED || quality == WAVES_QUALITY_MEDIUM_WARPED || quality == WAVES_QUALITY_HIGH_WARPED;
+}
+
+int getWaveOctavesForSpacing(WaveQuality quality, float spacing, float minVertsPerWavelength) {
+    const float TWO_PI = 6.28318530718f;
+    int octaves = getWaveQualityOctaves(quality);
+    while (octaves > 1 && TWO_PI / WAVE_OCTAVES.frequency[octaves - 1] < spacing * minVertsPerWavelength) octaves--;
+    return octaves;
+}
+
+static void writeGlslTable(std::ostringstream& out, const char* name, int octaves, float (*coefficient)(int)) {
+    out << "const float " << name << "[NUM_OF_SINE_WAVES] = float[](";
+    for (int i = 0; i < octaves; i++) {
+        if (i > 0) out << ", ";
+        out << coefficient(i);
+    }
+    out << ");\n";
+}
+
+static float amplitudeAt(int i) { return WAVE_OCTAVES.amplitude[i]; }
+static float frequencyAt(int i) { return WAVE_OCTAVES.frequency[i]; }
+static float phaseSpeedAt(int i) { return WAVE_OCTAVES.phaseSpeed[i]; }
+
+std::string getWavesGlslDefines(WaveQuality quality) {
+    int octaves = getWaveQualityOctaves(quality);
+
+    std::ostringstream out;
+    // scientific always prints a '.', which GLSL needs to read the values as floats
+    out << std::scientific << std::setprecision(9);
+    out << "#define NUM_OF_SINE_WAVES " << octaves << "\n";
+    out << "#define WAVES_DOMAIN_WARP " << (isWaveQualityWarped(quality) ? 1 : 0) << "\n";
+    writeGlslTable(out, "WAVE_AMPLITUDE", octaves, amplitudeAt);
+    writeGlslTable(out, "WAVE_FREQUENCY", octaves, frequencyAt);
+    writeGlslTable(out, "WAVE_PHASE_SPEED", octaves, phaseSpeedAt);
+    return out.str();
+}
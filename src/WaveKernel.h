@@ -0,0 +1,97 @@
+#pragma once
+
+#include "WaveSpectrum.h"
+
+#include <string>
+
+// Octave coefficients of the sum of sines, derived at compile time from the wave settings so the
+// kernels below can be fully unrolled with constants, and waves.vs can be generated from the same numbers.
+// The running products match the old b_a/b_f loop multiplication for multiplication.
+
+constexpr float waveOctaveFalloff(float rate, int i) {
+	float b = 1.0f;
+	for (int k = 0; k < i; k++) b *= rate;
+	return b;
+}
+
+constexpr float waveOctaveAmplitude(int i) {
+	return waveOctaveFalloff(WAVES_AMPLITUDE_FALLOFF, i) * WAVES_AMPLITUDES[i % 4];
+}
+
+constexpr float waveOctaveFrequency(int i) {
+	return waveOctaveFalloff(WAVES_FREQUENCY_GROWTH, i) * (2.0f / WAVES_LENGTHS[i % 4]);
+}
+
+constexpr float waveOctavePhaseSpeed(int i) {
+	return WAVES_SPEEDS[i % 4] * (2.0f / WAVES_LENGTHS[i % 4]);
+}
+
+// the coefficients of every octave, evaluated once at compile time; the kernels, the scalar path and
+// the generated GLSL all read these
+struct WaveOctaveTable {
+	float amplitude[NUM_OF_SINE_WAVES];
+	float frequency[NUM_OF_SINE_WAVES];
+	float phaseSpeed[NUM_OF_SINE_WAVES];
+};
+
+constexpr WaveOctaveTable makeWaveOctaveTable() {
+	WaveOctaveTable table = {};
+	for (int i = 0; i < NUM_OF_SINE_WAVES; i++) {
+		table.amplitude[i] = waveOctaveAmplitude(i);
+		table.frequency[i] = waveOctaveFrequency(i);
+		table.phaseSpeed[i] = waveOctavePhaseSpeed(i);
+	}
+	return table;
+}
+
+constexpr WaveOctaveTable WAVE_OCTAVES = makeWaveOctaveTable();
+
+enum WaveWarp {
+	WAVE_WARP_NONE,
+	// each octave's phase is offset by the slopes summed so far (dx + dz), like waves.vs always did
+	WAVE_WARP_DOMAIN
+};
+
+template <int Octaves, WaveWarp Warp>
+struct WaveKernel {
+	static_assert(Octaves > 0 && Octaves <= NUM_OF_SINE_WAVES, "WaveKernel octave count out of range");
+
+	static const int OCTAVES = Octaves;
+	static const WaveWarp WARP = Warp;
+
+	static constexpr float amplitude(int i) { return WAVE_OCTAVES.amplitude[i]; }
+	static constexpr float frequency(int i) { return WAVE_OCTAVES.frequency[i]; }
+	static constexpr float phaseSpeed(int i) { return WAVE_OCTAVES.phaseSpeed[i]; }
+};
+
+// The kernels that are compiled in. Cost is linear in the octave count.
+enum WaveQuality {
+	WAVES_QUALITY_LOW,
+	WAVES_QUALITY_LOW_WARPED,
+	WAVES_QUALITY_MEDIUM,
+	WAVES_QUALITY_MEDIUM_WARPED,
+	WAVES_QUALITY_HIGH,
+	WAVES_QUALITY_HIGH_WARPED,
+	NUM_OF_WAVES_QUALITIES
+};
+
+typedef WaveKernel<8, WAVE_WARP_NONE> WaveKernelLow;
+typedef WaveKernel<8, WAVE_WARP_DOMAIN> WaveKernelLowWarped;
+typedef WaveKernel<16, WAVE_WARP_NONE> WaveKernelMedium;
+typedef WaveKernel<16, WAVE_WARP_DOMAIN> WaveKernelMediumWarped;
+typedef WaveKernel<36, WAVE_WARP_NONE> WaveKernelHigh;
+typedef WaveKernel<36, WAVE_WARP_DOMAIN> WaveKernelHighWarped;
+
+// the preset waves.vs is generated with; sample with this one to match the drawn surface exactly
+const WaveQuality WAVES_RENDER_QUALITY = WAVES_QUALITY_HIGH_WARPED;
+
+int getWaveQualityOctaves(WaveQuality quality);
+bool isWaveQualityWarped(WaveQuality quality);
+
+// octaves of the preset that are worth drawing on a grid with this vertex spacing: everything after the
+// last octave whose wavelength still spans minVertsPerWavelength vertices is dropped
+int getWaveOctavesForSpacing(WaveQuality quality, float spacing, float minVertsPerWavelength);
+
+// GLSL block defining NUM_OF_SINE_WAVES, WAVES_DOMAIN_WARP and the WAVE_AMPLITUDE, WAVE_FREQUENCY
+// and WAVE_PHASE_SPEED constant tables for the given preset, to be inserted after #version in waves.vs
+std::string getWavesGlslDefines(WaveQuality quality);
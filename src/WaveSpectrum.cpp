@@ -0,0 +1,15 @@
+#include "WaveSpectrum.h"
+
+WaveSpectrum::WaveSpectrum() : waveCount(0) {
+}
+
+void WaveSpectrum::build(const glm::vec3* directions, int directionCount) {
+    waveCount = NUM_OF_SINE_WAVES;
+
+    for (int i = 0; i < waveCount; i++) {
+        glm::vec3 dir = glm::normalize(directions[i % directionCount]);
+
+        dirX[i] = dir.x;
+        dirZ[i] = dir.z;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Wave settings
+const int NUM_OF_SINE_WAVES = 36;
+const int NUM_OF_WAVE_DIRECTIONS = 12;
+constexpr float WAVES_SPEEDS[4] = { 3.0f, 5.0f, 3.0f, 6.0f };
+constexpr float WAVES_AMPLITUDES[4] = { 2.0f, 2.0f, 0.5f, 0.25f };
+//const float WAVES_LENGTH = 0.25f;
+const glm::vec3 WAVES_DIRECTIONS[4] = { glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(1.0f, 0.0f, 0.f), glm::vec3(-1.0f, 0.0f, -0.8f) };
+constexpr float WAVES_LENGTHS[4] = { 20.0f, 10.0f, 5.0f, 2.5f };
+// every octave is a bit smaller and a bit tighter than the one before
+constexpr float WAVES_AMPLITUDE_FALLOFF = 0.92f;
+constexpr float WAVES_FREQUENCY_GROWTH = 1.08f;
+
+const int MAX_SPECTRUM_WAVES = 64;
+
+// Per octave wave directions, normalized once from the random ones. The other coefficients don't depend
+// on them and are compile time constants (WAVE_OCTAVES in WaveKernel.h).
+// One array per component so the batch kernels and the shader upload can read them straight.
+struct WaveSpectrum {
+	WaveSpectrum();
+
+	void build(const glm::vec3* directions, int directionCount);
+
+	int waveCount;
+	alignas(32) float dirX[MAX_SPECTRUM_WAVES];
+	alignas(32) float dirZ[MAX_SPECTRUM_WAVES];
+};
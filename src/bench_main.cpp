@@ -0,0 +1,197 @@
+// Microbenchmarks for the CPU hot paths: single point wave sampling and the WAVES_SAMPLE_GRID_SIZE^2
+// buoyancy sampler (per point and batched, on every WaveBatch path), the AI boat turn and the fleet
+// passes at several fleet sizes. No window or GL context; the bench target in CMakeLists.txt builds it.
+//
+// Every benchmark runs warm (same inputs again and again, so they stay in cache) and cold (the caches
+// are flushed before every timed call). Results are the median of BENCH_REPEATS runs, per item: a
+// wave sample point for the wave benchmarks, a boat for the fleet ones.
+//
+// usage: bench [filter] [threads]
+//   filter   only run benchmarks whose name contains this (default all)
+//   threads  job threads for the fleet benchmarks, 0 for one per spare hardware thread (default 0)
+
+#include "Simulation.h"
+#include "WaveField.h"
+#include "WaveBatch.h"
+#include "Profiler.h"
+#include "Random.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Benchmark settings
+const unsigned int BENCH_SEED = 1;
+const unsigned int BENCH_REPEATS = 5;
+// each repeat runs for at least this long
+const double BENCH_MIN_SECONDS = 0.1;
+// larger than any last level cache we run on
+const size_t BENCH_CACHE_FLUSH_BYTES = 64 * 1024 * 1024;
+const unsigned int BENCH_POSITIONS = 1024;
+const float BENCH_POSITION_RANGE = 500.0f;
+const unsigned int BENCH_FLEET_SIZES[] = { 64, 1024, 8192 };
+const float BENCH_FLEET_DT = 1.0f / 60.0f;
+
+static const char* filter = "";
+static std::vector<char> flushBuffer;
+
+static void flushCaches() {
+    if (flushBuffer.empty()) flushBuffer.resize(BENCH_CACHE_FLUSH_BYTES);
+    // a write per cache line evicts whatever was cached before
+    for (size_t i = 0; i < flushBuffer.size(); i += 64) {
+        flushBuffer[i]++;
+    }
+}
+
+static void report(const std::string& name, const char* variant, double nsPerItem, const char* unit) {
+    std::cout << std::left << std::setw(40) << name << std::setw(6) << variant << std::right << std::fixed << std::setprecision(2)
+        << std::setw(12) << nsPerItem << " ns/" << std::left << std::setw(8) << unit << std::right << std::setprecision(0)
+        << std::setw(14) << (nsPerItem > 0.0 ? 1e9 / nsPerItem : 0.0) << " " << unit << "s/s" << std::endl;
+}
+
+// times run(), which handles items items per call, warm and cold
+template <typename Run>
+static void bench(const std::string& name, unsigned long items, const char* unit, Run run) {
+    if (strstr(name.c_str(), filter) == NULL) return;
+
+    const char* variants[] = { "warm", "cold" };
+    for (int cold = 0; cold < 2; cold++) {
+        std::vector<double> results;
+        for (unsigned int repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+            if (!cold) run();
+
+            double seconds = 0.0;
+            unsigned long calls = 0;
+            while (seconds < BENCH_MIN_SECONDS) {
+                if (cold) flushCaches();
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                run();
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                calls++;
+            }
+            results.push_back(seconds * 1e9 / ((double)calls * (double)items));
+        }
+        std::sort(results.begin(), results.end());
+        report(name, variants[cold], results[results.size() / 2], unit);
+    }
+}
+
+static void benchWaves(const WaveField& waves, const std::vector<glm::vec3>& positions) {
+    std::vector<glm::vec3> results(positions.size());
+    std::vector<glm::vec3> normals(positions.size());
+    const unsigned int gridSamples = WAVES_SAMPLE_GRID_SIZE * WAVES_SAMPLE_GRID_SIZE;
+
+    const WaveQuality qualities[] = { WAVES_RENDER_QUALITY, FAR_BOAT_WAVES_QUALITY };
+    const char* qualityNames[] = { "render", "far" };
+    for (int q = 0; q < 2; q++) {
+        WaveQuality quality = qualities[q];
+        std::string suffix = std::string("/") + qualityNames[q];
+
+        // the per point entry points dispatch to the current WaveBatch path too, the scalar rows are the baseline
+        WaveSampleBuffer buffer;
+        WaveBatch::Path best = WaveBatch::detectPath();
+        for (int path = WaveBatch::SCALAR; path <= best; path++) {
+            WaveBatch::setPath((WaveBatch::Path)path);
+            std::string pathName = std::string("/") + WaveBatch::getPathName((WaveBatch::Path)path);
+
+            bench("waves.sample" + pathName + suffix, positions.size(), "sample", [&]() {
+                for (unsigned int i = 0; i < positions.size(); i++) {
+                    results[i] = waves.sample(positions[i], normals[i], quality);
+                }
+            });
+
+            bench("waves.sampleAverage" + pathName + suffix, positions.size() * gridSamples, "sample", [&]() {
+                for (unsigned int i = 0; i < positions.size(); i++) {
+                    results[i] = waves.sampleAverage(positions[i], normals[i], quality);
+                }
+            });
+
+            bench("waves.sampleAverageBatch" + pathName + suffix, positions.size() * gridSamples, "sample", [&]() {
+                waves.sampleAverageBatch(positions.data(), (int)positions.size(), buffer, results.data(), normals.data(), quality);
+            });
+        }
+        WaveBatch::setPath(best);
+    }
+}
+
+// Fleet::turnBoat() alone: fixed forwards and directions, and it only writes the bearings, so every
+// call turns the same boats the same way
+static void benchSteering() {
+    Random::init(BENCH_SEED);
+    Fleet fleet;
+    std::vector<glm::vec3> directions(BENCH_POSITIONS);
+    for (unsigned int i = 0; i < BENCH_POSITIONS; i++) {
+        Boat boat;
+        boat.forward = glm::normalize(glm::vec3(Random::randFloat(1.0f), Random::randFloat(0.1f), Random::randFloat(1.0f)));
+        fleet.add(boat);
+        directions[i] = glm::vec3(Random::randFloat(1.0f), 0.0f, Random::randFloat(1.0f));
+    }
+
+    bench("fleet.turnBoat", BENCH_POSITIONS, "turn", [&]() {
+        for (unsigned int i = 0; i < BENCH_POSITIONS; i++) {
+            fleet.turnBoat(i, directions[i].x, directions[i].z, BOAT_TURN_RATE * BENCH_FLEET_DT);
+        }
+    });
+}
+
+// whole fleet updates, then the passes of the last warm run from the profiler
+static void benchFleet(unsigned int boats, unsigned int jobThreads) {
+    std::string name = "fleet.update/" + std::to_string(boats);
+    if (strstr(name.c_str(), filter) == NULL) return;
+
+    Random::init(BENCH_SEED);
+    Simulation simulation;
+    simulation.setJobThreads(jobThreads);
+    simulation.init(boats);
+
+    bench(name, boats, "boat", [&]() {
+        simulation.update(BENCH_FLEET_DT);
+    });
+
+    const unsigned int frames = 100;
+    Profiler::setEnabled(true);
+    for (unsigned int i = 0; i < frames; i++) {
+        Profiler::beginFrame();
+        simulation.update(BENCH_FLEET_DT);
+    }
+    Profiler::setEnabled(false);
+
+    std::vector<ProfileZoneStats> zones;
+    Profiler::getSummary(zones, frames);
+    const char* passes[] = { "buoyancy", "float boats", "boat hash", "steer boats" };
+    for (unsigned int p = 0; p < sizeof(passes) / sizeof(passes[0]); p++) {
+        for (unsigned int z = 0; z < zones.size(); z++) {
+            if (zones[z].name != passes[p]) continue;
+            report(name + " " + passes[p], "warm", zones[z].p50 * 1e6 / boats, "boat");
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    filter = argc > 1 ? argv[1] : "";
+    unsigned int jobThreads = argc > 2 ? (unsigned int)strtoul(argv[2], NULL, 10) : JOB_THREADS_AUTO;
+
+    Random::init(BENCH_SEED);
+    WaveField waves;
+    waves.init();
+    waves.advance(12.5f);
+
+    std::vector<glm::vec3> positions(BENCH_POSITIONS);
+    for (unsigned int i = 0; i < positions.size(); i++) {
+        positions[i] = glm::vec3(Random::randFloat(BENCH_POSITION_RANGE), 0.0f, Random::randFloat(BENCH_POSITION_RANGE));
+    }
+
+    std::cout << "wave batch path: " << WaveBatch::getPathName(WaveBatch::detectPath()) << std::endl;
+    benchWaves(waves, positions);
+    benchSteering();
+    for (unsigned int i = 0; i < sizeof(BENCH_FLEET_SIZES) / sizeof(BENCH_FLEET_SIZES[0]); i++) {
+        benchFleet(BENCH_FLEET_SIZES[i], jobThreads);
+    }
+    return 0;
+}
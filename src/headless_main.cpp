@@ -0,0 +1,91 @@
+// Headless driver for the simulation: steps the ocean and boats without a window or GL context
+// and dumps the boat states, for soak tests and throughput runs on render-less machines.
+//
+// usage: headless [--seed N] [ticks] [dt] [dumpEvery] [heightfield] [boats] [threads] [trace]
+//   --seed     random seed of the boats, anywhere on the command line (default HEADLESS_DEFAULT_SEED);
+//              the same seed and arguments give the same dump
+//   ticks      number of simulation steps (default 1000)
+//   dt         seconds per step (default 1/144)
+//   dumpEvery  print the state every N ticks, 0 to only print the final state (default 0)
+//   heightfield  1 to float the boats on the baked wave heightfield (default USE_WAVES_HEIGHTFIELD)
+//   boats        number of AI boats (default MAX_OTHER_BOATS_COUNT)
+//   threads      job threads besides the main one, 0 for one per spare hardware thread (default 0)
+//   trace        profile the run, print the zone summary and write a Chrome trace to this file
+
+#include "Simulation.h"
+#include "Random.h"
+#include "Profiler.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// fixed, so runs are reproducible unless asked otherwise
+const unsigned int HEADLESS_DEFAULT_SEED = 1;
+
+static void dumpState(std::ostream& out, unsigned long tick, const Simulation& simulation) {
+    const Boat& player = simulation.getPlayer();
+    out << "tick " << tick << " time " << simulation.getWaves().getTime() << "\n";
+    out << "  player " << player.position.x << " " << player.position.y << " " << player.position.z
+        << " up " << player.up.x << " " << player.up.y << " " << player.up.z << "\n";
+
+    const Fleet& otherBoats = simulation.getOtherBoats();
+    for (unsigned int i = 0; i < otherBoats.size(); i++) {
+        Boat boat = otherBoats.get(i);
+        out << "  boat " << i << " " << boat.position.x << " " << boat.position.y << " " << boat.position.z
+            << " speed " << boat.speed << (boat.isFlipped ? " flipped" : "") << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int seed = HEADLESS_DEFAULT_SEED;
+    // the positional arguments, without the options
+    std::vector<char*> args(1, argv[0]);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else args.push_back(argv[i]);
+    }
+    argc = (int)args.size();
+    argv = args.data();
+
+    unsigned long ticks = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+    float dt = argc > 2 ? (float)atof(argv[2]) : 1.0f / 144.0f;
+    unsigned long dumpEvery = argc > 3 ? strtoul(argv[3], NULL, 10) : 0;
+    bool useHeightfield = argc > 4 ? atoi(argv[4]) != 0 : USE_WAVES_HEIGHTFIELD;
+    unsigned int otherBoatsCount = argc > 5 ? (unsigned int)strtoul(argv[5], NULL, 10) : MAX_OTHER_BOATS_COUNT;
+    unsigned int jobThreads = argc > 6 ? (unsigned int)strtoul(argv[6], NULL, 10) : JOB_THREADS_AUTO;
+    const char* tracePath = argc > 7 ? argv[7] : NULL;
+
+    Profiler::setThreadName("main");
+    Profiler::setEnabled(tracePath != NULL);
+
+    Random::init(seed);
+
+    Simulation simulation;
+    simulation.init(otherBoatsCount);
+    simulation.setWavesHeightfieldEnabled(useHeightfield);
+    simulation.setJobThreads(jobThreads);
+
+    std::cout << "seed " << seed << " boats " << otherBoatsCount << " dt " << dt << " heightfield " << (useHeightfield ? 1 : 0) << "\n";
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long tick = 1; tick <= ticks; tick++) {
+        Profiler::beginFrame();
+        simulation.update(dt);
+        if (dumpEvery > 0 && tick % dumpEvery == 0) dumpState(std::cout, tick, simulation);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (dumpEvery == 0 || ticks % dumpEvery != 0) dumpState(std::cout, ticks, simulation);
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << ticks << " ticks on " << simulation.getJobThreads() + 1 << " threads in " << seconds << " s (" << (seconds > 0.0 ? ticks / seconds : 0.0) << " ticks/s)" << std::endl;
+
+    if (tracePath != NULL) {
+        Profiler::writeSummary(std::cout, (unsigned int)ticks);
+        Profiler::writeChromeTrace(tracePath);
+    }
+    return 0;
+}
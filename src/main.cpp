@@ -1,8 +1,11 @@
 #include "Game.h"
+#include "FramePacer.h"
+#include "Benchmark.h"
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-
-// timing
-float lastFrame = 0.0f;
+#include <sstream>
+#include <string>
 
 Game* gamePtr = nullptr;
 float lastX;
@@ -15,8 +18,38 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window, float dt);
 
-int main()
+// usage: Waves [--threads N] [--sim-rate HZ] [--pacing MODE] [--fps N] [--profile FILE]
+//              [--benchmark FILE [--seed N] [--frames N] [--boats N]]
+//   --threads   simulation job threads besides the main one, 0 for one per spare hardware thread (default 0)
+//   --sim-rate  fixed simulation steps per second (default SIMULATION_DEFAULT_RATE)
+//   --pacing    limited, vsync, adaptive or uncapped (default limited)
+//   --fps       frame rate of the limited mode (default TARGET_FPS)
+//   --profile   profile from the start, print the zone summary and write a Chrome trace to FILE on exit
+//   --benchmark run the scripted benchmark in a hidden window and write its results as JSON to FILE,
+//               with a fixed seed (default BENCHMARK_DEFAULT_SEED), frame count and AI boat count
+int main(int argc, char** argv)
 {
+    unsigned int jobThreads = JOB_THREADS_AUTO;
+    float simulationRate = SIMULATION_DEFAULT_RATE;
+    FramePacer::Mode pacingMode = FramePacer::LIMITED;
+    double targetFps = TARGET_FPS;
+    std::string tracePath;
+    BenchmarkOptions benchmark;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) jobThreads = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--sim-rate") == 0 && i + 1 < argc) simulationRate = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--pacing") == 0 && i + 1 < argc) {
+            if (!FramePacer::parseMode(argv[++i], pacingMode)) std::cout << "Unknown pacing mode: " << argv[i] << std::endl;
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) targetFps = atof(argv[++i]);
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) tracePath = argv[++i];
+        else if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) benchmark.outputPath = argv[++i];
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) benchmark.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) benchmark.frames = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--boats") == 0 && i + 1 < argc) benchmark.otherBoatsCount = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else std::cout << "Unknown argument: " << argv[i] << std::endl;
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -27,6 +60,9 @@ int main()
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    // the benchmark draws offscreen
+    bool benchmarkMode = !benchmark.outputPath.empty();
+    if (benchmarkMode) glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
 
     // glfw window creation
     // --------------------
@@ -45,7 +81,7 @@ int main()
     glfwSetScrollCallback(window, scroll_callback);
 
     // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (!benchmarkMode) glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
@@ -55,16 +91,48 @@ int main()
         return -1;
     }
 
+    // the program binary cache needs 4.1, glad leaves its entry points null on the 3.3 context we ask for;
+    // GL_ARB_get_program_binary has them under the same names
+    if (!GLAD_GL_VERSION_4_1 && glfwExtensionSupported("GL_ARB_get_program_binary"))
+    {
+        glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)glfwGetProcAddress("glGetProgramBinary");
+        glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)glfwGetProcAddress("glProgramBinary");
+        glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)glfwGetProcAddress("glProgramParameteri");
+    }
+
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
 
-    // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
-    stbi_set_flip_vertically_on_load(true);
+    // frame pacing
+    // ------------
+    if (pacingMode == FramePacer::ADAPTIVE && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+        std::cout << "Adaptive vsync is not supported, using vsync" << std::endl;
+        pacingMode = FramePacer::VSYNC;
+    }
+    FramePacer framePacer;
+    framePacer.configure(pacingMode, targetFps);
+    glfwSwapInterval(framePacer.getSwapInterval());
+    double lastStatsTime = 0.0;
+
+    // model textures are flipped per texture by the TextureLoader, stb_image's global flip stays off
+    // since the decode threads share it
 
+    Profiler::setThreadName("main");
+    Profiler::setEnabled(!tracePath.empty());
 
     Game game;
     gamePtr = &game;
+    game.setJobThreads(jobThreads);
+    game.setSimulationRate(simulationRate);
+
+    if (benchmarkMode) {
+        glfwSwapInterval(0);
+        Benchmark run(benchmark);
+        bool succeeded = run.run(game);
+        glfwTerminate();
+        return succeeded ? 0 : 1;
+    }
 
     // render loop
     // -----------
@@ -72,12 +140,21 @@ int main()
     {
         // per-frame time logic
         // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
-        float dt = currentFrame - lastFrame;
-
-        if (dt < MIN_TIME_PER_FRAME) continue;
-
-        lastFrame = currentFrame;
+        float dt = static_cast<float>(framePacer.waitForNextFrame());
+        Profiler::beginFrame();
+
+        double currentTime = glfwGetTime();
+        if (currentTime - lastStatsTime >= FRAME_STATS_INTERVAL) {
+            lastStatsTime = currentTime;
+            FramePacerStats stats = framePacer.getStats();
+            if (stats.meanInterval > 0.0) {
+                std::ostringstream title;
+                title.precision(3);
+                title << "Waves - " << FramePacer::getModeName(framePacer.getMode()) << " " << 1.0 / stats.meanInterval << " fps, jitter "
+                    << stats.meanJitter * 1000.0 << " ms avg " << stats.maxJitter * 1000.0 << " ms max";
+                glfwSetWindowTitle(window, title.str().c_str());
+            }
+        }
 
 
         // input
@@ -97,6 +174,11 @@ int main()
         glfwPollEvents();
     }
 
+    if (!tracePath.empty()) {
+        Profiler::writeSummary(std::cout);
+        Profiler::writeChromeTrace(tracePath);
+    }
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
@@ -3,12 +3,10 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 texCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
-
 void main()
 {
-    vec4 pos = projection * view * vec4(aPos, 1.0f);
+    // rotation only, the skybox stays centered on the camera
+    vec4 pos = projection * mat4(mat3(view)) * vec4(aPos, 1.0f);
     // Having z equal w will always result in a depth of 1.0f
     gl_Position = vec4(pos.x, pos.y, pos.w, pos.w);
     // We want to flip the z axis due to the different coordinate systems (left hand vs right hand)
@@ -0,0 +1,35 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aNormal; // octahedral, see encodeOctahedral() in mesh.h
+layout (location = 2) in vec2 aTexCoords;
+// per instance model matrix, locations 3 to 6 are taken by the mesh's tangents and bones
+layout (location = 7) in mat4 aModel;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+// positions may be quantized to the mesh bounds, see VertexFormat in mesh.h
+uniform vec3 meshPositionOffset;
+uniform vec3 meshPositionScale;
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    // the lower hemisphere is folded over the diagonals
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 position = meshPositionOffset + meshPositionScale * aPos;
+    vec3 normal = decodeOctahedral(aNormal);
+    TexCoords = aTexCoords;    
+    FragPos = vec3(aModel * vec4(position, 1.0));
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+    // instance matrices only rotate, flip and scale uniformly, so no inverse transpose is needed
+    Normal = mat3(aModel) * normal;
+}
@@ -14,14 +14,6 @@ struct PointLight {
     vec3 specular;
 };
 
-struct DirLight {
-    vec3 direction;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
 struct SpotLight {
     vec3 position;
     vec3 direction;
@@ -44,8 +36,6 @@ in vec3 Normal;
 //in vec2 TexCoords;
 
 uniform vec3 color;
-uniform vec3 viewPos;
-uniform DirLight dirLight;
 uniform PointLight pointLights[NUM_OF_POINT_LIGHTS];
 uniform SpotLight spotLight;
 uniform float shininess;
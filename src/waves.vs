@@ -1,25 +1,36 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
+// vertex in the patch (in vertices), then per instance: x/z offset of the tile from the grid center and
+// its vertex spacing, and the ring's blend start/end distance, full weight octaves and drawn octaves
+layout (location = 0) in vec2 aPatchPos;
+layout (location = 1) in vec3 aTile;
+layout (location = 2) in vec4 aLod;
 
 out vec3 FragPos;
 out vec3 Normal;
 
+// grid center, the camera position snapped to the outermost ring's grid
 uniform vec3 camOffset;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
-#define NUM_OF_SINE_WAVES 36
+// NUM_OF_SINE_WAVES, WAVES_DOMAIN_WARP and the WAVE_AMPLITUDE, WAVE_FREQUENCY and WAVE_PHASE_SPEED
+// tables are generated from WaveKernel.h (getWavesGlslDefines) and inserted after #version
 
-uniform float time;
-uniform float amplitude[NUM_OF_SINE_WAVES];
-uniform float wavelength[NUM_OF_SINE_WAVES];
-uniform vec3 direction[NUM_OF_SINE_WAVES];
-uniform float speed[NUM_OF_SINE_WAVES];
+// normalized wave directions (x, z) from WaveSpectrum, written once by Game::uploadWaveSpectrum()
+layout (std140) uniform WaveSpectrumBlock {
+    vec4 waveDirections[NUM_OF_SINE_WAVES];
+};
 
 void main()
 {
+    vec2 local = aTile.xy + aPatchPos * aTile.z;
+    // towards the outer edge of a ring the odd vertices slide onto the next ring's (twice as coarse) grid
+    // and the octaves that ring drops fade out, so both sides of the seam end up on the same surface
+    float morph = clamp((max(abs(local.x), abs(local.y)) - aLod.x) / (aLod.y - aLod.x), 0.0, 1.0);
+    local -= mod(aPatchPos, 2.0) * aTile.z * morph;
+    int octaves = int(aLod.w);
+
+    vec3 aPos = vec3(local.x, 0.0, local.y);
     vec3 pos = aPos;
     pos.x += camOffset.x;
     pos.z += camOffset.z;
@@ -28,26 +39,22 @@ void main()
     float dx = 0.0;
     float dz = 0.0;
 
-    float b_a = 1.0;
-    float b_f = 1.0;
-
-    for (int i = 0 ; i < NUM_OF_SINE_WAVES; i++){
-        vec3 dir = normalize(direction[i]);
-        float frequency = 2.0 / wavelength[i];
-        float phase = speed[i] * (2.0 / wavelength[i]);
-
-        float a = b_a * amplitude[i];
-        float f = b_f * frequency;
-
-        //float a = amplitude[i];
-        //float f = frequency;
+    for (int i = 0 ; i < octaves; i++){
+        float a = WAVE_AMPLITUDE[i] * (float(i) < aLod.z ? 1.0 : 1.0 - morph);
+        float f = WAVE_FREQUENCY[i];
+        vec2 dir = waveDirections[i].xy;
 
-        height += a * exp(sin(((dir.x * pos.x + dir.z * pos.z) + dx + dz) * f + time * phase) - 1.0);
-        dx += f * dir.x * a * cos(((dir.x * pos.x + dir.z * pos.z) + dx + dz) * f + time * phase) * exp(sin(((dir.x * pos.x + dir.z * pos.z) + dx + dz) * f + time * phase) - 1.0);
-        dz += f * dir.z * a * cos(((dir.x * pos.x + dir.z * pos.z) + dx + dz) * f + time * phase) * exp(sin(((dir.x * pos.x + dir.z * pos.z) + dx + dz) * f + time * phase) - 1.0);
+        float offset = dir.x * pos.x + dir.y * pos.z;
+#if WAVES_DOMAIN_WARP
+        offset += dx + dz;
+#endif
+        float dotPhase = offset * f + time * WAVE_PHASE_SPEED[i];
+        float exponent = exp(sin(dotPhase) - 1.0);
+        float slope = a * cos(dotPhase) * exponent * f;
 
-        b_a *= 0.92;
-        b_f *= 1.08;
+        height += a * exponent;
+        dx += dir.x * slope;
+        dz += dir.y * slope;
     }
 
     vec3 normal = normalize(vec3(-dx, 1.0, -dz));
@@ -58,5 +65,5 @@ void main()
     //Normal = mat3(transpose(inverse(model))) * aNormal;
     Normal = mat3(transpose(inverse(model))) * normal;
     //Normal = mat3(transpose(inverse(model))) * vec3(0,1,0);
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
 }
\ No newline at end of file